@@ -81,6 +81,15 @@ static ko_longopt_t long_options[] = {
     { "ul-m",     ko_required_argument, 363},
     { "rl-cut",     ko_required_argument, 364},
     { "sc-cut",     ko_required_argument, 365},
+    { "h-batch",     ko_required_argument, 366},
+    { "h-pipe",     ko_required_argument, 367},
+    { "h-io",     ko_required_argument, 368},
+    { "h-mem",     ko_required_argument, 369},
+    { "ul-chain",     ko_required_argument, 370},
+    { "ul-gaf",     ko_no_argument, 372},
+    { "ul-triage",     ko_required_argument, 373},
+    { "ul-mem",     ko_required_argument, 374},
+    { "graph-ckpt",     ko_no_argument, 375},
     // { "path-round",     ko_required_argument, 348},
 	{ 0, 0, 0 }
 };
@@ -123,6 +132,7 @@ void Print_H(hifiasm_opt_t* asm_opt)
     fprintf(stderr, "    -x FLOAT     max overlap drop ratio [%.2g]\n", asm_opt->max_drop_rate);
     fprintf(stderr, "    -y FLOAT     min overlap drop ratio [%.2g]\n", asm_opt->min_drop_rate);
     fprintf(stderr, "    -i           ignore saved read correction and overlaps\n");
+    fprintf(stderr, "    --graph-ckpt save the cleaned string graph to PREFIX.ckpt.bin and resume from it\n");
     fprintf(stderr, "    -u           post-join step for contigs which may improve N50; 0 to disable; 1 to enable\n");
     fprintf(stderr, "                 [%u] and [%u] in default for the UL+HiFi assembly and the HiFi assembly, respectively\n",
                                       asm_opt->ul_pst_join, asm_opt->hifi_pst_join);
@@ -186,6 +196,14 @@ void Print_H(hifiasm_opt_t* asm_opt)
 	fprintf(stderr, "                 fraction to flip for perturbation [%.3g]\n", asm_opt->f_perturb);
     fprintf(stderr, "    --l-msjoin   INT\n");
     fprintf(stderr, "                 detect misjoined unitigs of >=INT in size; 0 to disable [%lu]\n", asm_opt->misjoin_len);
+    fprintf(stderr, "    --h-batch    INT(k, m or g)\n");
+    fprintf(stderr, "                 bases of Hi-C reads mapped per batch [%ld]\n", asm_opt->hic_batch);
+    fprintf(stderr, "    --h-pipe     INT\n");
+    fprintf(stderr, "                 number of Hi-C batches in flight [%d]\n", asm_opt->hic_pipe_depth);
+    fprintf(stderr, "    --h-io       INT\n");
+    fprintf(stderr, "                 Hi-C reader threads, 1 or 2; 2 to decompress R1 and R2 concurrently [%d]\n", asm_opt->hic_io_thread);
+    fprintf(stderr, "    --h-mem      INT(k, m or g)\n");
+    fprintf(stderr, "                 spill sorted Hi-C hits to disk beyond INT bytes; 0 to disable [%lu]\n", asm_opt->hic_hit_mem);
 
     fprintf(stderr, "  Ultra-Long-integration:\n");
     fprintf(stderr, "    --ul FILEs   file names of Ultra-Long reads [r1.fq,r2.fq,...]\n");
@@ -206,6 +224,15 @@ void Print_H(hifiasm_opt_t* asm_opt)
     fprintf(stderr, "                 but may lead to more misassemblies\n");
     fprintf(stderr, "    --ul-cut     INT\n");
     fprintf(stderr, "                 filter out <INT UL reads during the UL assembly [%d]\n", asm_opt->ul_min_base);
+    fprintf(stderr, "    --ul-chain   INT\n");
+    fprintf(stderr, "                 UL anchor chaining. 0: DP; 1: range-maximum-query (faster on very long reads) [%d]\n", asm_opt->ul_chain);
+    fprintf(stderr, "    --ul-gaf     write UL-to-unitig alignments of each UL round to PREFIX.*.ul.gaf.gz;\n");
+    fprintf(stderr, "                 residue matches (column 10) are 0; not written for rounds loaded from *.ul.ovlp.bin\n");
+    fprintf(stderr, "    --ul-triage  FLOAT\n");
+    fprintf(stderr, "                 skip UL reads whose identity estimated from sampled anchors is <FLOAT; 0 to disable [%.3g]\n", asm_opt->ul_triage);
+    fprintf(stderr, "    --ul-mem     INT(k, m or g)\n");
+    fprintf(stderr, "                 page UL alignment blocks and bases from disk once INT bytes are resident at a UL round;\n");
+    fprintf(stderr, "                 0 to disable [%lu]\n", asm_opt->ul_spill_mem);
     // fprintf(stderr, "    --low-het    enable it for genomes with very low het heterozygosity rate (<0.0001%%)\n");
 
     fprintf(stderr, "  Dual-Scaffolding:\n");
@@ -373,6 +400,14 @@ void init_opt(hifiasm_opt_t* asm_opt)
 
     asm_opt->rl_cut = 1000;
     asm_opt->sc_cut = 10;
+    asm_opt->hic_batch = 20000000;
+    asm_opt->hic_pipe_depth = 3;
+    asm_opt->hic_io_thread = 2;
+    asm_opt->hic_hit_mem = 8000000000ULL;
+    asm_opt->ul_chain = 0;
+    asm_opt->ul_gaf = 0;
+    asm_opt->ul_triage = 0;
+    asm_opt->ul_spill_mem = 1073741824ULL;
 }   
 
 void destory_enzyme(enzyme* f)
@@ -664,6 +699,24 @@ int check_option(hifiasm_opt_t* asm_opt)
         return 0;
     }
 
+    if(asm_opt->hic_batch <= 0 || asm_opt->hic_pipe_depth < 2 || asm_opt->hic_io_thread < 1 || asm_opt->hic_io_thread > 2)
+    {
+        fprintf(stderr, "[ERROR] wrong Hi-C mapping pipeline (--h-batch, --h-pipe >= 2 and --h-io in [1, 2])\n");
+        return 0;
+    }
+
+    if(asm_opt->ul_chain != 0 && asm_opt->ul_chain != 1)
+    {
+        fprintf(stderr, "[ERROR] must be 0 or 1 (--ul-chain)\n");
+        return 0;
+    }
+
+    if(asm_opt->ul_triage < 0 || asm_opt->ul_triage >= 1)
+    {
+        fprintf(stderr, "[ERROR] must be >= 0 and < 1 (--ul-triage)\n");
+        return 0;
+    }
+
     if(asm_opt->hic_enzymes != NULL && asm_opt->hic_enzymes->n == 0)
     {
         fprintf(stderr, "[ERROR] wrong HiC enzymes (--enzyme)\n");
@@ -1003,6 +1056,24 @@ int CommandLine_process(int argc, char *argv[], hifiasm_opt_t* asm_opt)
             asm_opt->rl_cut = atol(opt.arg);
         } else if (c == 365) {
             asm_opt->sc_cut = atol(opt.arg);
+        } else if (c == 366) {
+            asm_opt->hic_batch = inter_gsize(opt.arg);
+        } else if (c == 367) {
+            asm_opt->hic_pipe_depth = atoi(opt.arg);
+        } else if (c == 368) {
+            asm_opt->hic_io_thread = atoi(opt.arg);
+        } else if (c == 369) {
+            asm_opt->hic_hit_mem = inter_gsize(opt.arg);
+        } else if (c == 370) {
+            asm_opt->ul_chain = atoi(opt.arg);
+        } else if (c == 372) {
+            asm_opt->ul_gaf = 1;
+        } else if (c == 373) {
+            asm_opt->ul_triage = atof(opt.arg);
+        } else if (c == 374) {
+            asm_opt->ul_spill_mem = inter_gsize(opt.arg);
+        } else if (c == 375) {
+            asm_opt->flag |= HA_F_GRAPH_CKPT;
         } else if (c == 'l') {   ///0: disable purge_dup; 1: purge containment; 2: purge overlap
             asm_opt->purge_level_primary = asm_opt->purge_level_trio = atoi(opt.arg);
         }
@@ -23,6 +23,7 @@
 #define HA_F_PARTITION       0x800
 #define HA_F_FAST            0x1000
 #define HA_F_USKEW           0x2000
+#define HA_F_GRAPH_CKPT      0x4000
 
 #define HA_MIN_OV_DIFF       0.02 // min sequence divergence in an overlap
 #define MIN_N_CHAIN          100
@@ -170,6 +171,16 @@ typedef struct {
     int64_t rl_cut;
     int64_t sc_cut;
 
+    int64_t hic_batch;
+    int hic_pipe_depth;
+    int hic_io_thread;
+    uint64_t hic_hit_mem;
+
+    int ul_chain;
+    int ul_gaf;
+    double ul_triage;
+    uint64_t ul_spill_mem;
+
 } hifiasm_opt_t;
 
 extern hifiasm_opt_t asm_opt;
@@ -22424,12 +22424,56 @@ kv_ul_ov_t *aln, uint64_t rid, int64_t max_lgap, double sgap_rate)
 
 
 
+// data structure for each step in kt_for()
+typedef struct {
+    overlap_region_alloc *ol;
+    Candidates_list *cl;
+    const ul_idx_t *uref;
+    ul_aln_mt_t *mt;
+    char *qs;
+    uint64_t *v_idx, khit;
+    double e_rate, e_max;
+    int64_t wl, ql, sid;
+    double *rr;
+    int64_t *re;
+} ul_aln_mt_aux_t;
+
+static void ul_aln_mt_init(ul_aln_mt_aux_t *s, ul_aln_mt_t *mt, overlap_region_alloc* ol, Candidates_list *cl, const ul_idx_t *uref, 
+char *qs, int64_t ql, double e_rate, int64_t wl, int64_t sid, uint64_t khit, uint64_t bs)
+{
+    int64_t i;
+    memset(s, 0, sizeof((*s)));
+    s->ol = ol; s->cl = cl; s->uref = uref; s->mt = mt; s->qs = qs; s->ql = ql; 
+    s->e_rate = e_rate; s->wl = wl; s->sid = sid; s->khit = khit;
+    MALLOC(s->rr, ol->length); MALLOC(s->re, ol->length);
+    for (i = 0; i < mt->n_thread; i++) resize_UC_Read(mt->tu[i], bs<<1);
+}
+
+static void worker_for_ul_lalign_ed(void *data, long i, int tid) // callback for kt_for()
+{
+    ul_aln_mt_aux_t *s = (ul_aln_mt_aux_t*)data; 
+    overlap_region *z = &(s->ol->list[i]); uint64_t ovl = z->x_pos_e+1-z->x_pos_s; 
+    z->shared_seed = z->non_homopolymer_errors;///for index
+    s->re[i] = 0;
+    if(!align_ul_ed_post_extz(z, s->uref, NULL, s->qs, s->mt->tu[tid]->seq, s->mt->exz[tid], s->e_rate, s->wl, -1, 0, NULL)) return;
+    if(s->uref && simi_pass(ovl, z->align_length, s->uref?1:0, -1, NULL)) {
+        z->is_match = 3; s->re[i] = 1;
+    }
+}
+
+static void worker_for_ul_lalign_ext(void *data, long i, int tid) // callback for kt_for()
+{
+    ul_aln_mt_aux_t *s = (ul_aln_mt_aux_t*)data; 
+    s->rr[i] = gen_extend_err_exz(&(s->ol->list[i]), s->uref, NULL, NULL, s->qs, s->mt->tu[tid]->seq, s->mt->exz[tid], s->v_idx, 
+                        s->wl, -1, s->e_rate, (s->e_max+0.000001), THRESHOLD_MAX_SIZE, 1, &(s->re[i]));
+}
+
 void ul_lalign(overlap_region_alloc* ol, Candidates_list *cl, const ul_idx_t *uref, const ug_opt_t *uopt, 
         char *qstr, uint64_t ql, UC_Read* qu, UC_Read* tu, Correct_dumy* dumy, bit_extz_t *exz, haplotype_evdience_alloc* hap, 
         kvec_t_u64_warp* v_idx, overlap_region *aux_o, double e_rate, int64_t wl, kv_ul_ov_t *aln, int64_t sid, uint64_t khit, 
-        st_mt_t *stb, idx_emask_t *mm, mask_ul_ov_t *mk, void *km)
+        st_mt_t *stb, idx_emask_t *mm, mask_ul_ov_t *mk, ul_aln_mt_t *mt, void *km)
 {
-    uint64_t i, bs, k, ovl/**, on**/; Window_Pool w; double err; 
+    uint64_t i, bs, k, ovl/**, on**/; Window_Pool w; double err; ul_aln_mt_aux_t au;
     /**int64_t sc;**/ overlap_region t; overlap_region *z; asg64_v iidx, buf, buf1;
     ol->mapped_overlaps_length = 0;
     if(ol->length <= 0) return;
@@ -22442,14 +22486,24 @@ void ul_lalign(overlap_region_alloc* ol, Candidates_list *cl, const ul_idx_t *ur
 
     if(!aln) {    
         resize_UC_Read(qu, ql); qu->length = ql; memcpy(qu->seq, qstr, ql);
-        for (i = 0; i < ol->length; i++) {
-            z = &(ol->list[i]); ovl = z->x_pos_e+1-z->x_pos_s; 
-            z->shared_seed = z->non_homopolymer_errors;///for index
-            if(!align_ul_ed_post_extz(z, uref, NULL, qu->seq, tu->seq, exz, err, w.window_length, -1, 0, km)) {
-                continue;
+        ///overlaps are aligned independently; split them across threads for a long read
+        if(mt && mt->n_thread > 1 && (!km) && ol->length > 1) {
+            ul_aln_mt_init(&au, mt, ol, cl, uref, qu->seq, ql, err, w.window_length, sid, khit, bs);
+            kt_for(mt->n_thread, worker_for_ul_lalign_ed, &au, ol->length);
+            for (i = 0; i < ol->length; i++) {
+                if(au.re[i]) ol->mapped_overlaps_length += ol->list[i].align_length;
             }
-            if(uref && simi_pass(ovl, z->align_length, uref?1:0, -1, NULL)) {
-                z->is_match = 3; ol->mapped_overlaps_length += z->align_length;
+        } else {
+            au.mt = NULL;
+            for (i = 0; i < ol->length; i++) {
+                z = &(ol->list[i]); ovl = z->x_pos_e+1-z->x_pos_s; 
+                z->shared_seed = z->non_homopolymer_errors;///for index
+                if(!align_ul_ed_post_extz(z, uref, NULL, qu->seq, tu->seq, exz, err, w.window_length, -1, 0, km)) {
+                    continue;
+                }
+                if(uref && simi_pass(ovl, z->align_length, uref?1:0, -1, NULL)) {
+                    z->is_match = 3; ol->mapped_overlaps_length += z->align_length;
+                }
             }
         }
 
@@ -22458,9 +22512,17 @@ void ul_lalign(overlap_region_alloc* ol, Candidates_list *cl, const ul_idx_t *ur
         }
 
         double e_max = err*1.5, rr; int64_t re;
+        if(au.mt) {
+            au.v_idx = v_idx?v_idx->a.a:NULL; au.e_max = e_max;
+            kt_for(au.mt->n_thread, worker_for_ul_lalign_ext, &au, ol->length);
+        }
         for (i = k = 0; i < ol->length; i++) {
             z = &(ol->list[i]); ovl = z->x_pos_e + 1 - z->x_pos_s;
-            rr = gen_extend_err_exz(z, uref, NULL, NULL, qu->seq, tu->seq, exz, v_idx?v_idx->a.a:NULL, w.window_length, -1, err, (e_max+0.000001), THRESHOLD_MAX_SIZE, 1, &re);
+            if(au.mt) {
+                rr = au.rr[i]; re = au.re[i];
+            } else {
+                rr = gen_extend_err_exz(z, uref, NULL, NULL, qu->seq, tu->seq, exz, v_idx?v_idx->a.a:NULL, w.window_length, -1, err, (e_max+0.000001), THRESHOLD_MAX_SIZE, 1, &re);
+            }
             z->is_match = 0;///must be here;
 
 
@@ -22485,6 +22547,9 @@ void ul_lalign(overlap_region_alloc* ol, Candidates_list *cl, const ul_idx_t *ur
                 k++;
             } 
         }
+        if(au.mt) {
+            free(au.rr); free(au.re);
+        }
 
         ol->length = k;
         // fprintf(stderr, "+[M::%s] on::%lu\n", __func__, ol->length);
@@ -25080,11 +25145,20 @@ void dedup_ul_ov_t(kv_ul_ov_t *in)
     in->n = m;
 }
 
+static void worker_for_ul_rid_lalign(void *data, long i, int tid) // callback for kt_for()
+{
+    ul_aln_mt_aux_t *s = (ul_aln_mt_aux_t*)data; 
+    overlap_region *z = &(s->ol->list[i]);
+    z->shared_seed = z->non_homopolymer_errors;///for index
+    s->re[i] = ul_local_aln(z, s->cl, s->uref, s->qs, s->mt->tu[tid], s->mt->exz[tid], s->e_rate, s->wl, 
+            1000, OVERLAP_THRESHOLD_NOSI_FILTER, NULL, NULL, NULL, s->ql, s->sid, i, s->khit, NULL);
+}
+
 void ul_rid_lalign_adv(overlap_region_alloc* ol, Candidates_list *cl, const ul_idx_t *uref, const ug_opt_t *uopt, 
         char *qstr, uint64_t ql, UC_Read* qu, UC_Read* tu, bit_extz_t *exz, overlap_region *aux_o, double e_rate, 
-        int64_t wl, kv_ul_ov_t *aln, kv_ul_ov_t *cln, kv_rtrace_t *trace, int64_t sid, uint64_t khit, void *km)
+        int64_t wl, kv_ul_ov_t *aln, kv_ul_ov_t *cln, kv_rtrace_t *trace, int64_t sid, uint64_t khit, ul_aln_mt_t *mt, void *km)
 {
-    uint64_t i, bs, k; Window_Pool w; double err; 
+    uint64_t i, bs, k; Window_Pool w; double err; ul_aln_mt_aux_t au;
     overlap_region t; overlap_region *z; //asg64_v iidx, buf, buf1;
     ol->mapped_overlaps_length = 0;
     if(ol->length <= 0) return;
@@ -25097,11 +25171,21 @@ void ul_rid_lalign_adv(overlap_region_alloc* ol, Candidates_list *cl, const ul_i
 
     if(!aux_o) {
         resize_UC_Read(qu, ql); qu->length = ql; memcpy(qu->seq, qstr, ql); 
+        au.mt = NULL;
+        ///overlaps are aligned independently; split them across threads for a long read
+        if(mt && mt->n_thread > 1 && ol->length > 1) {
+            ul_aln_mt_init(&au, mt, ol, cl, uref, qu->seq, ql, err, w.window_length, sid, khit, bs);
+            kt_for(mt->n_thread, worker_for_ul_rid_lalign, &au, ol->length);
+        }
         for (i = k = 0; i < ol->length; i++) {
-            z = &(ol->list[i]); z->shared_seed = z->non_homopolymer_errors;///for index
-            if(!ul_local_aln(z, cl, uref, qu->seq, tu, exz, err, w.window_length, 
-            1000, OVERLAP_THRESHOLD_NOSI_FILTER, NULL, NULL, NULL, ql, sid, i, khit, NULL)) {
-                continue;
+            if(au.mt) {
+                if(!au.re[i]) continue;
+            } else {
+                z = &(ol->list[i]); z->shared_seed = z->non_homopolymer_errors;///for index
+                if(!ul_local_aln(z, cl, uref, qu->seq, tu, exz, err, w.window_length, 
+                1000, OVERLAP_THRESHOLD_NOSI_FILTER, NULL, NULL, NULL, ql, sid, i, khit, NULL)) {
+                    continue;
+                }
             }
             if(k != i) {
                 t = ol->list[k];
@@ -25110,6 +25194,9 @@ void ul_rid_lalign_adv(overlap_region_alloc* ol, Candidates_list *cl, const ul_i
             }
             z = &(ol->list[k++]); z->is_match = 1; 
         }
+        if(au.mt) {
+            free(au.rr); free(au.re);
+        }
         ol->length = k;
         if(ol->length <= 0) return;
     } else {
@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <pthread.h>
+#include "smmintrin.h"
 #include "Hash_Table.h"
 #include "ksort.h"
 #include "kalloc.h"
@@ -13,6 +14,7 @@ KRADIX_SORT_INIT(overlap_region_sort, overlap_region, overlap_region_key, member
 
 #define generic_key(x) (x)
 KRADIX_SORT_INIT(hc64i, int64_t, generic_key, 8)
+KRADIX_SORT_INIT(lc64, uint64_t, generic_key, 8)
 
 #define oreg_sss_lt(a, b) ((a).shared_seed > (b).shared_seed) // in the decending order
 KSORT_INIT(or_sss, overlap_region, oreg_sss_lt)
@@ -1565,12 +1567,98 @@ inline int32_t comput_sc_ff(const k_mer_hit *ai, const k_mer_hit *aj, double bw_
     return sc;
 }
 
+///comput_sc_ch() (or comput_sc_ch_ec() if is_ec) of ai against aj[0..3] at once; sc[k] is the score of aj[3-k]
+///every step is the same integer/double operation as the scalar version, so the scores are identical
+static inline void comput_sc_ch4(const k_mer_hit *ai, const k_mer_hit *aj, double bw_rate, double chn_pen_gap, double chn_pen_skip, int64_t sl, int64_t ol, int32_t is_ec, int32_t *sc)
+{
+    __m128i r0, r1, r2, r3, of, so, dq, dr, dd, dg, x, bw, sfs, m, pm, z, zh;
+    __m128d d_rate, d_gap, d_skip, lo, hi, lin, apen, scd;
+    int32_t q_span = ai->cnt&(0xffu), w = (int32_t)(ai->cnt>>8), h; int64_t e, r;
+    r0 = _mm_loadu_si128((const __m128i*)(aj));
+    r1 = _mm_loadu_si128((const __m128i*)(aj+1));
+    r2 = _mm_loadu_si128((const __m128i*)(aj+2));
+    r3 = _mm_loadu_si128((const __m128i*)(aj+3));
+    x = _mm_unpacklo_epi32(r0, r1); z = _mm_unpacklo_epi32(r2, r3);
+    of = _mm_unpackhi_epi64(x, z);///aj[].offset
+    x = _mm_unpackhi_epi32(r0, r1); z = _mm_unpackhi_epi32(r2, r3);
+    so = _mm_unpacklo_epi64(x, z);///aj[].self_offset
+
+    dq = _mm_sub_epi32(_mm_set1_epi32((int32_t)ai->self_offset), so);
+    dr = _mm_sub_epi32(_mm_set1_epi32((int32_t)ai->offset), of);
+    m = _mm_and_si128(_mm_cmpgt_epi32(dq, _mm_setzero_si128()), _mm_cmpgt_epi32(dr, _mm_setzero_si128()));
+    dd = _mm_abs_epi32(_mm_sub_epi32(dr, dq));
+    dg = _mm_min_epi32(dr, dq);
+
+    ///cal_bw()
+    e = (int64_t)ai->self_offset + 1; r = ol - ((int64_t)ai->offset + 1);
+    if (sl - e <= r) e = sl; 
+    else e += r;
+    sfs = _mm_max_epi32(_mm_sub_epi32(so, of), _mm_setzero_si128());
+    x = _mm_sub_epi32(_mm_set1_epi32((int32_t)e), sfs); d_rate = _mm_set1_pd(bw_rate);
+    lo = _mm_mul_pd(_mm_cvtepi32_pd(x), d_rate);
+    hi = _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(x, 0xee)), d_rate);
+    bw = _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+    x = _mm_and_si128(_mm_cmpgt_epi32(dd, _mm_set1_epi32(16)), _mm_cmpgt_epi32(dd, bw));
+    m = _mm_andnot_si128(x, m);
+
+    ///normal_w()
+    x = _mm_min_epi32(dg, _mm_set1_epi32(q_span));
+    if (w == 1) {
+        z = _mm_max_epi32(x, _mm_set1_epi32(1));
+    } else {
+        lo = _mm_div_pd(_mm_cvtepi32_pd(x), _mm_set1_pd((double)w));
+        hi = _mm_div_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(x, 0xee)), _mm_set1_pd((double)w));
+        z = _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+        z = _mm_blendv_epi8(_mm_set1_epi32(1), z, _mm_cmpgt_epi32(x, _mm_set1_epi32(w - 1)));
+    }
+
+    ///gap penalty
+    pm = _mm_or_si128(_mm_xor_si128(_mm_cmpeq_epi32(dd, _mm_setzero_si128()), _mm_set1_epi32(-1)), 
+            _mm_cmpgt_epi32(dg, _mm_set1_epi32(q_span)));
+    d_gap = _mm_set1_pd(chn_pen_gap); d_skip = _mm_set1_pd(chn_pen_skip);
+    for (h = 0, zh = _mm_setzero_si128(); h < 2; h++) {
+        __m128i s_dd = h? _mm_shuffle_epi32(dd, 0xee) : dd, s_dg = h? _mm_shuffle_epi32(dg, 0xee) : dg;
+        __m128i s_z = h? _mm_shuffle_epi32(z, 0xee) : z;
+        __m128d f_dd = _mm_cvtepi32_pd(s_dd), f_dg = _mm_cvtepi32_pd(s_dg);
+        lin = _mm_mul_pd(d_gap, f_dd);
+        scd = _mm_cvtepi32_pd(s_z);
+        apen = _mm_mul_pd(scd, _mm_div_pd(_mm_div_pd(f_dd, f_dg), d_rate));
+        if (!is_ec) {
+            lin = _mm_min_pd(apen, lin);
+        } else {
+            __m128d sm = _mm_castsi128_pd(_mm_cvtepi32_epi64(_mm_cmplt_epi32(s_dd, _mm_set1_epi32(4))));
+            lin = _mm_blendv_pd(_mm_max_pd(apen, lin), _mm_min_pd(apen, lin), sm);
+        }
+        lin = _mm_add_pd(lin, _mm_mul_pd(d_skip, f_dg));
+        x = _mm_cvttpd_epi32(lin);
+        if (h) zh = _mm_unpacklo_epi64(zh, x);
+        else zh = x;
+    }
+    z = _mm_blendv_epi8(z, _mm_sub_epi32(z, zh), pm);
+    z = _mm_blendv_epi8(_mm_set1_epi32(INT32_MIN), z, m);
+    _mm_storeu_si128((__m128i*)sc, _mm_shuffle_epi32(z, _MM_SHUFFLE(0, 1, 2, 3)));
+}
+
+///fill sc[k] with the score of a[j-k] as the predecessor of a[i], for k = 0..3 and j-k >= st
+static inline void lchain_sc_blk(const k_mer_hit *a, int64_t i, int64_t j, int64_t st, double bw_rate, double chn_pen_gap, double chn_pen_skip, int64_t sl, int64_t ol, int32_t is_ec, int32_t *sc)
+{
+    int64_t k;
+    if (j >= 3) {
+        comput_sc_ch4(&a[i], &a[j-3], bw_rate, chn_pen_gap, chn_pen_skip, sl, ol, is_ec, sc);
+    } else {
+        for (k = 0; k < 4 && j - k >= st; k++) {
+            if (is_ec) sc[k] = comput_sc_ch_ec(&a[i], &a[j-k], bw_rate, chn_pen_gap, chn_pen_skip, sl, ol);
+            else sc[k] = comput_sc_ch(&a[i], &a[j-k], bw_rate, chn_pen_gap, chn_pen_skip, sl, ol);
+        }
+    }
+}
+
 uint64_t lchain_dp(k_mer_hit* a, int64_t a_n, k_mer_hit* des, Chain_Data* dp, overlap_region* res, 
               int64_t max_skip, int64_t max_iter, int64_t max_dis, double chn_pen_gap, double chn_pen_skip, double bw_rate, 
               int64_t xl, int64_t yl, int64_t quick_check)
 {
     int64_t *p, *t, max_f, n_skip, st, max_j, end_j, sc, msc, msc_i, bw, max_ii, ovl, movl; 
-    int32_t *f, max, tmp; int64_t i, j, ret, cL = 0;
+    int32_t *f, max, tmp, sc4[4]; int64_t i, j, ret, cL = 0;
     resize_Chain_Data(dp, a_n, NULL);
     t = dp->tmp; f = dp->score; p = dp->pre;
     bw = ((xl < yl)?xl:yl); bw *= bw_rate;
@@ -1591,7 +1679,8 @@ uint64_t lchain_dp(k_mer_hit* a, int64_t a_n, k_mer_hit* des, Chain_Data* dp, ov
         if ((i-st) > max_iter) st = i-max_iter;
 
         for (j = i - 1; j >= st; --j) {
-			sc = comput_sc_ch(&a[i], &a[j], bw_rate, chn_pen_gap, chn_pen_skip, xl, yl);
+			if (((i-1-j)&3) == 0) lchain_sc_blk(a, i, j, st, bw_rate, chn_pen_gap, chn_pen_skip, xl, yl, 0, sc4);
+			sc = sc4[(i-1-j)&3];
 			if (sc == INT32_MIN) continue;
 			sc += f[j];
 			if (sc > max_f) {
@@ -1655,7 +1744,7 @@ uint64_t lchain_qdp(k_mer_hit* a, int64_t a_n, k_mer_hit* des, Chain_Data* dp, o
               int64_t xl, int64_t yl, int64_t quick_check)
 {
     int64_t *p, *t, max_f, n_skip, st, max_j, end_j, sc, msc, msc_i, bw, max_ii, ovl, movl; 
-    int32_t *f, max, tmp; int64_t i, j, ret, cL = 0;
+    int32_t *f, max, tmp, sc4[4]; int64_t i, j, ret, cL = 0;
     resize_Chain_Data(dp, a_n, NULL);
     t = dp->tmp; f = dp->score; p = dp->pre;
     bw = ((xl < yl)?xl:yl); bw *= bw_rate;
@@ -1679,7 +1768,8 @@ uint64_t lchain_qdp(k_mer_hit* a, int64_t a_n, k_mer_hit* des, Chain_Data* dp, o
         if ((i-st) > max_iter) st = i-max_iter;
 
         for (j = i - 1; j >= st; --j) {
-            sc = comput_sc_ch(&a[i], &a[j], bw_rate, chn_pen_gap, chn_pen_skip, xl, yl);
+            if (((i-1-j)&3) == 0) lchain_sc_blk(a, i, j, st, bw_rate, chn_pen_gap, chn_pen_skip, xl, yl, 0, sc4);
+            sc = sc4[(i-1-j)&3];
             if (sc == INT32_MIN) continue;
             sc += f[j];
             if (sc > max_f) {
@@ -1838,6 +1928,56 @@ int64_t filter_non_ovlp_xchains(overlap_region *a, int64_t a_n, int64_t *n_v)
 	return n_mchain;
 }
 
+///fill f[] and p[] of lchain_qdp_mcopy() by range-maximum queries;
+///a[] is sorted by strand and self_offset, active anchors are keyed by offset;
+///anchors more than max_dis behind a[i] on self_offset are dropped, as max_dist_x in mg_lchain_rmq()
+static void lchain_rmq_fill(k_mer_hit* a, int64_t a_n, int32_t *f, int64_t *p, int64_t max_skip, int64_t max_iter, 
+              int64_t max_dis, double chn_pen_gap, double chn_pen_skip, double bw_rate, int64_t xl, int64_t yl)
+{
+    int64_t i, j, k, l, r, st, i0, sz, max_j, max_f, sc, *rk, *id; 
+    uint64_t *srt; uint32_t *os; double *sv, hw = 0.5*chn_pen_gap;
+    ///rank anchors by offset
+    MALLOC(srt, a_n);
+    for (i = 0; i < a_n; ++i) srt[i] = (((uint64_t)a[i].offset)<<32)|((uint64_t)i);
+    radix_sort_lc64(srt, srt + a_n);
+    MALLOC(rk, a_n); MALLOC(os, a_n);
+    for (k = 0; k < a_n; ++k) rk[(uint32_t)srt[k]] = k, os[k] = srt[k]>>32;
+    free(srt);
+    for (sz = 1; sz < a_n; sz <<= 1);
+    MALLOC(sv, sz<<1); MALLOC(id, sz<<1);
+    for (k = 0; k < (sz<<1); ++k) id[k] = -1;
+
+    for (i = st = i0 = 0; i < a_n; ++i) {
+        max_f = a[i].cnt&(0xffu); max_j = -1;
+        ///drop anchors that are out of range
+        for (; st < i && (a[st].strand != a[i].strand || (int64_t)a[i].self_offset > (int64_t)a[st].self_offset + max_dis); ++st) {
+            if (st < i0) lc_rmq_set(sz, sv, id, rk[st], -1, 0);
+        }
+        if (i0 < st) i0 = st;
+        ///anchors at the same self_offset cannot be predecessors
+        for (; i0 < i && a[i0].self_offset < a[i].self_offset; ++i0) {
+            lc_rmq_set(sz, sv, id, rk[i0], i0, f[i0] + hw*((double)a[i0].offset + (double)a[i0].self_offset));
+        }
+        ///predecessors have offset < a[i].offset
+        for (l = 0, r = rk[i]; l < r; ) {
+            k = (l + r)>>1;
+            if (os[k] < a[i].offset) l = k + 1;
+            else r = k;
+        }
+        if (l > 0 && (j = lc_rmq_max(sz, sv, id, 0, l)) >= 0) {
+            sc = comput_sc_ch(&a[i], &a[j], bw_rate, chn_pen_gap, chn_pen_skip, xl, yl);
+            if (sc != INT32_MIN && sc + f[j] > max_f) max_f = sc + f[j], max_j = j;
+        }
+        ///close predecessors catch what the linear gap approximation misses; at most max_iter back, as the DP
+        for (j = i - 1, k = 0; j >= st && k < max_skip && k < max_iter; --j, ++k) {
+            sc = comput_sc_ch(&a[i], &a[j], bw_rate, chn_pen_gap, chn_pen_skip, xl, yl);
+            if (sc != INT32_MIN && sc + f[j] > max_f) max_f = sc + f[j], max_j = j;
+        }
+        f[i] = max_f; p[i] = max_j;
+    }
+    free(rk); free(os); free(sv); free(id);
+}
+
 uint64_t lchain_qdp_mcopy(Candidates_list *cl, int64_t a_idx, int64_t a_n, int64_t des_idx, 
               Chain_Data* dp, overlap_region_alloc* res, int64_t max_skip, int64_t max_iter, 
               int64_t max_dis, double chn_pen_gap, double chn_pen_skip, double bw_rate, 
@@ -1847,7 +1987,7 @@ uint64_t lchain_qdp_mcopy(Candidates_list *cl, int64_t a_idx, int64_t a_n, int64
 {
     if(a_n <= 0) return 0;
     int64_t *p, *t, max_f, n_skip, st, max_j, end_j, sc, msc, msc_i, bw, max_ii, ovl, movl, plus = 0, min_sc, ch_n; 
-    int32_t *f, max, tmp, *ii; int64_t i, k, j, cL = 0; k_mer_hit* a; k_mer_hit* des; k_mer_hit *swap; overlap_region *z;
+    int32_t *f, max, tmp, sc4[4], *ii; int64_t i, k, j, cL = 0; k_mer_hit* a; k_mer_hit* des; k_mer_hit *swap; overlap_region *z;
     resize_Chain_Data(dp, a_n, NULL);
     t = dp->tmp; f = dp->score; p = dp->pre; ii = dp->occ;
     bw = ((xl < yl)?xl:yl); bw *= bw_rate;
@@ -1859,45 +1999,52 @@ uint64_t lchain_qdp_mcopy(Candidates_list *cl, int64_t a_idx, int64_t a_n, int64
     // }
 
     memset(t, 0, (a_n*sizeof((*t))));
-    for (i = st = plus = 0, max_ii = -1; i < a_n; ++i) {
-        max_f = a[i].cnt&(0xffu); 
-        n_skip = 0; max_j = end_j = -1;
-        if ((i-st) > max_iter) st = i-max_iter;
-        while (a[i].strand != a[st].strand) ++st;
-
-        for (j = i - 1; j >= st; --j) {
-            sc = comput_sc_ch(&a[i], &a[j], bw_rate, chn_pen_gap, chn_pen_skip, xl, yl);
-            if (sc == INT32_MIN) continue;
-            sc += f[j];
-            if (sc > max_f) {
-                max_f = sc, max_j = j;
-                if (n_skip > 0) --n_skip;
-            } else if (t[j] == (int32_t)i) {
-                if (++n_skip > max_skip)
-                    break;
+    if (dp->is_rmq && a_n >= LC_RMQ_MIN_N) {
+        lchain_rmq_fill(a, a_n, f, p, max_skip, max_iter, max_dis, chn_pen_gap, chn_pen_skip, bw_rate, xl, yl);
+    } else {
+        for (i = st = 0, max_ii = -1; i < a_n; ++i) {
+            max_f = a[i].cnt&(0xffu); 
+            n_skip = 0; max_j = end_j = -1;
+            if ((i-st) > max_iter) st = i-max_iter;
+            while (a[i].strand != a[st].strand) ++st;
+
+            for (j = i - 1; j >= st; --j) {
+                if (((i-1-j)&3) == 0) lchain_sc_blk(a, i, j, st, bw_rate, chn_pen_gap, chn_pen_skip, xl, yl, 0, sc4);
+                sc = sc4[(i-1-j)&3];
+                if (sc == INT32_MIN) continue;
+                sc += f[j];
+                if (sc > max_f) {
+                    max_f = sc, max_j = j;
+                    if (n_skip > 0) --n_skip;
+                } else if (t[j] == (int32_t)i) {
+                    if (++n_skip > max_skip)
+                        break;
+                }
+                if (p[j] >= 0) t[p[j]] = i;
             }
-            if (p[j] >= 0) t[p[j]] = i;
-        }
-        end_j = j;
+            end_j = j;
 
-        if ((max_ii<0) || (a[i].self_offset>a[max_ii].self_offset+max_dis) || (a[i].strand!=a[max_ii].strand)) {
-            max = INT32_MIN; max_ii = -1;
-            for (j=i-1; (j>=st) && (a[i].self_offset<=max_dis+a[j].self_offset)&&(a[i].strand==a[j].strand); --j) {
-                if (max < f[j]) {
-                    max = f[j], max_ii = j;
+            if ((max_ii<0) || (a[i].self_offset>a[max_ii].self_offset+max_dis) || (a[i].strand!=a[max_ii].strand)) {
+                max = INT32_MIN; max_ii = -1;
+                for (j=i-1; (j>=st) && (a[i].self_offset<=max_dis+a[j].self_offset)&&(a[i].strand==a[j].strand); --j) {
+                    if (max < f[j]) {
+                        max = f[j], max_ii = j;
+                    }
                 }
             }
-        }
 
-        if (max_ii >= 0 && max_ii < end_j) {///just have a try with a[i]<->a[max_ii]
-            tmp = comput_sc_ch(&a[i], &a[max_ii], bw_rate, chn_pen_gap, chn_pen_skip, xl, yl);
-            if (tmp != INT32_MIN && max_f < tmp + f[max_ii])
-                max_f = tmp + f[max_ii], max_j = max_ii;
-        }
-        f[i] = max_f; p[i] = max_j;
-        if ((max_ii < 0) || ((a[i].self_offset<=max_dis+a[max_ii].self_offset)&&(a[i].strand==a[max_ii].strand)&&(f[max_ii]<f[i]))) {
-            max_ii = i;
+            if (max_ii >= 0 && max_ii < end_j) {///just have a try with a[i]<->a[max_ii]
+                tmp = comput_sc_ch(&a[i], &a[max_ii], bw_rate, chn_pen_gap, chn_pen_skip, xl, yl);
+                if (tmp != INT32_MIN && max_f < tmp + f[max_ii])
+                    max_f = tmp + f[max_ii], max_j = max_ii;
+            }
+            f[i] = max_f; p[i] = max_j;
+            if ((max_ii < 0) || ((a[i].self_offset<=max_dis+a[max_ii].self_offset)&&(a[i].strand==a[max_ii].strand)&&(f[max_ii]<f[i]))) {
+                max_ii = i;
+            }
         }
+    }
+    for (i = plus = 0; i < a_n; ++i) {
         if(f[i] >= msc) {
             ovl = get_chainLen(a[i].self_offset, a[i].self_offset, xl, a[i].offset, a[i].offset, yl);
             if(f[i] > msc || ovl < movl) {
@@ -2103,7 +2250,7 @@ uint64_t lchain_qdp_mcopy_fast(Candidates_list *cl, int64_t a_idx, int64_t a_n,
 {
     if(a_n <= 0) return 0;
     int64_t *p, *t, max_f, n_skip, st, max_j, end_j, sc, msc, msc_i, max_ii, ovl, movl, plus = 0, min_sc, ch_n, si, ei; 
-    int32_t *f, max, tmp, *ii; int64_t i, k, j, cL = 0; k_mer_hit* a; k_mer_hit* des; k_mer_hit *swap; overlap_region *z;
+    int32_t *f, max, tmp, sc4[4], *ii; int64_t i, k, j, cL = 0; k_mer_hit* a; k_mer_hit* des; k_mer_hit *swap; overlap_region *z;
     resize_Chain_Data(dp, a_n, NULL); ch_n = 1; // int64_t bw; bw = ((xl < yl)?xl:yl); bw *= bw_rate;
     t = dp->tmp; f = dp->score; p = dp->pre; ii = dp->occ;
     
@@ -2128,7 +2275,8 @@ uint64_t lchain_qdp_mcopy_fast(Candidates_list *cl, int64_t a_idx, int64_t a_n,
         while (a[i].strand != a[st].strand) ++st;
 
         for (j = i - 1; j >= st; --j) {
-            sc = comput_sc_ch_ec(&a[i], &a[j], bw_rate, chn_pen_gap, chn_pen_skip, xl, yl);
+            if (((i-1-j)&3) == 0) lchain_sc_blk(a, i, j, st, bw_rate, chn_pen_gap, chn_pen_skip, xl, yl, 1, sc4);
+            sc = sc4[(i-1-j)&3];
             if (sc == INT32_MIN) continue;
             sc += f[j];
             if (sc > max_f) {
@@ -128,6 +128,7 @@ typedef struct {
 	int64_t *tmp; // MUST BE 64-bit integer
 	int64_t length;
 	int64_t size;
+	int32_t is_rmq; ///chain long hit lists by range-maximum queries instead of DP
 } Chain_Data;
 
 typedef struct
@@ -188,6 +189,38 @@ static inline long long y_start_offset(long long x_start, Fake_Cigar* o)
     return get_fake_gap_shift(o, i - 1);
 }
 
+///anchor lists shorter than this are always chained by DP
+#define LC_RMQ_MIN_N 512
+
+///max segment tree for RMQ chaining; v[]: priority, id[]: anchor idx (-1 if inactive)
+static inline void lc_rmq_set(int64_t sz, double *v, int64_t *id, int64_t k, int64_t i, double pri)
+{
+	int64_t l, r;
+	k += sz; v[k] = pri; id[k] = i;
+	for (k >>= 1; k > 0; k >>= 1) {
+		l = k<<1; r = l + 1;
+		if (id[l] >= 0 && (id[r] < 0 || v[l] > v[r] || (v[l] == v[r] && id[l] > id[r]))) v[k] = v[l], id[k] = id[l];
+		else v[k] = v[r], id[k] = id[r];
+	}
+}
+
+///max over ranks [l, r); ties go to the larger anchor idx; return -1 if empty
+static inline int64_t lc_rmq_max(int64_t sz, const double *v, const int64_t *id, int64_t l, int64_t r)
+{
+	int64_t m = -1; double mv = 0;
+	for (l += sz, r += sz; l < r; l >>= 1, r >>= 1) {
+		if (l&1) {
+			if (id[l] >= 0 && (m < 0 || v[l] > mv || (v[l] == mv && id[l] > m))) mv = v[l], m = id[l];
+			++l;
+		}
+		if (r&1) {
+			--r;
+			if (id[r] >= 0 && (m < 0 || v[r] > mv || (v[r] == mv && id[r] > m))) mv = v[r], m = id[r];
+		}
+	}
+	return m;
+}
+
 void resize_Chain_Data(Chain_Data* x, long long size, void *km);
 void init_window_list_alloc(window_list_alloc* x);
 void clear_window_list_alloc(window_list_alloc* x);
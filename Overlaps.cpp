@@ -2,6 +2,11 @@
 #include <stdlib.h>
 #define __STDC_LIMIT_MACROS
 #include <stdint.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include "Overlaps.h"
 #include "ksort.h"
 #include "Process_Read.h"
@@ -895,6 +900,176 @@ void asg_arc_index(asg_t *g)
 	g->idx = asg_arc_index_core(g->n_seq, g->n_arc, g->arc);
 }
 
+///g must be indexed; arcs with del are skipped, so readers don't need to check them
+asg_csr_t *asg_csr_gen(const asg_t *g)
+{
+    asg_csr_t *c = NULL;
+    uint32_t v, i, nv;
+    uint64_t m;
+    const asg_arc_t *av;
+    CALLOC(c, 1);
+    c->n_vtx = g->n_seq<<1;
+    CALLOC(c->off, c->n_vtx + 1);
+    for (v = 0; v < c->n_vtx; v++)
+    {
+        av = asg_arc_a(g, v); nv = asg_arc_n(g, v);
+        for (i = m = 0; i < nv; i++) m += (!av[i].del);
+        c->off[v+1] = c->off[v] + m;
+    }
+    c->n_arc = c->off[c->n_vtx];
+    MALLOC(c->v, c->n_arc); MALLOC(c->len, c->n_arc); MALLOC(c->flag, c->n_arc);
+    for (v = 0; v < c->n_vtx; v++)
+    {
+        av = asg_arc_a(g, v); nv = asg_arc_n(g, v);
+        for (i = 0, m = c->off[v]; i < nv; i++)
+        {
+            if(av[i].del) continue;
+            c->v[m] = av[i].v; c->len[m] = asg_arc_len(av[i]);
+            c->flag[m] = (av[i].strong?ASG_CSR_STRONG:0)|(av[i].el?ASG_CSR_EL:0)|(av[i].no_l_indel?ASG_CSR_NO_L_INDEL:0);
+            m++;
+        }
+    }
+    return c;
+}
+
+void asg_csr_destroy(asg_csr_t *c)
+{
+    if (c == 0) return;
+    free(c->off); free(c->v); free(c->len); free(c->flag);
+    free(c);
+}
+
+typedef struct { // data structure for each step in kt_for()
+    ma_ug_t *ug;
+    ma_ug_pseq_t *p;
+    int free_s;
+} ug_pseq_aux_t;
+
+static void worker_ug_pseq_gen(void *data, long i, int tid) // callback for kt_for()
+{
+    ug_pseq_aux_t *aux = (ug_pseq_aux_t*)data;
+    ma_utg_t *u = &(aux->ug->u.a[i]);
+    uint8_t *a = aux->p->a + (aux->p->off[i]>>2);
+    uint64_t k, c, m = 0, *N = aux->p->N + aux->p->N_idx[i];
+    if(!u->s) return;
+    for (k = 0; k < u->len; k++) {
+        c = seq_nt4_table[(uint8_t)u->s[k]];
+        if(c >= 4) {
+            if(m > 0 && (N[m-1]>>32) + (uint32_t)N[m-1] == k) N[m-1]++;
+            else N[m++] = k<<32|1;
+            c = 0;
+        }
+        a[k>>2] |= c<<((3-(k&3))<<1);
+    }
+    if(aux->free_s && u->len > 0) {
+        free(u->s); u->s = NULL;
+    }
+}
+
+///pack u->s of all unitigs; if free_s, u->s is released so that only the packed copy stays in memory
+ma_ug_pseq_t *ma_ug_pseq_gen(ma_ug_t *ug, int free_s)
+{
+    ma_ug_pseq_t *p = NULL; CALLOC(p, 1);
+    ug_pseq_aux_t aux;
+    uint64_t i, k, c, nn;
+    init_aux_table();
+    p->n = ug->u.n;
+    CALLOC(p->off, p->n + 1); CALLOC(p->N_idx, p->n + 1); CALLOC(p->len, p->n);
+    for (i = 0; i < p->n; i++) {
+        if(ug->u.a[i].s) p->len[i] = ug->u.a[i].len;
+        p->off[i+1] = p->off[i] + (((uint64_t)p->len[i] + 3)&(~3ULL));
+        nn = 0;
+        if(ug->u.a[i].s) {
+            for (k = 0, c = 0; k < ug->u.a[i].len; k++) {
+                if(seq_nt4_table[(uint8_t)ug->u.a[i].s[k]] >= 4) {
+                    if(!c) nn++;
+                    c = 1;
+                } else {
+                    c = 0;
+                }
+            }
+        }
+        p->N_idx[i+1] = p->N_idx[i] + nn;
+    }
+    CALLOC(p->a, (p->off[p->n]>>2) + 1); MALLOC(p->N, p->N_idx[p->n] + 1);
+    CALLOC(p->ends, p->n); MALLOC(p->fid, p->n);
+    for (i = 0; i < p->n; i++) {
+        if(ug->u.a[i].n > 0) p->ends[i] = (ug->u.a[i].a[0]>>32<<32)|(ug->u.a[i].a[ug->u.a[i].n-1]>>32);
+        p->fid[i] = (p->ends[i]>>32<<32)|i;
+    }
+    radix_sort_arch64(p->fid, p->fid + p->n);
+    aux.ug = ug; aux.p = p; aux.free_s = free_s;
+    kt_for(asm_opt.thread_num, worker_ug_pseq_gen, &aux, p->n);
+    return p;
+}
+
+void ma_ug_pseq_destroy(ma_ug_pseq_t *p)
+{
+    if (p == 0) return;
+    free(p->off); free(p->len); free(p->a); free(p->N_idx); free(p->N);
+    free(p->ends); free(p->fid);
+    free(p);
+}
+
+///decode [s, s+l) of unitig uid into dst; if strand, [s, s+l) is on the reverse complement
+void ma_ug_pseq_retrieve(const ma_ug_pseq_t *p, uint32_t uid, uint8_t strand, uint64_t s, uint64_t l, char *dst)
+{
+    uint64_t k, x, e, ns, ne, *N = p->N + p->N_idx[uid], nn = p->N_idx[uid+1] - p->N_idx[uid];
+    char c;
+    if(l == 0) return;
+    if(strand) s = p->len[uid] - s - l;
+    e = s + l;
+    for (k = 0, x = p->off[uid] + s; k < l; k++, x++) {
+        dst[k] = bit_t_seq_table[p->a[x>>2]][x&3];
+    }
+    for (k = 0; k < nn && (N[k]>>32) < e; k++) {
+        ns = N[k]>>32; ne = ns + (uint32_t)N[k];
+        if(ne <= s) continue;
+        if(ns < s) ns = s;
+        if(ne > e) ne = e;
+        memset(dst + ns - s, 'N', ne - ns);
+    }
+    if(strand) {
+        for (k = 0; k < (l>>1); k++) {
+            c = dst[l-k-1]; dst[l-k-1] = RC_CHAR(dst[k]); dst[k] = RC_CHAR(c);
+        }
+        if(l&1) dst[l>>1] = RC_CHAR(dst[l>>1]);
+    }
+}
+
+///the packed unitig with the same reads at both ends and the same length as u; -1 if none
+static uint64_t ma_ug_pseq_find(const ma_ug_pseq_t *p, const ma_utg_t *u)
+{
+    uint64_t l = 0, r = p->n, m, e, k;
+    if(u->n == 0 || !u->a) return (uint64_t)-1;
+    e = (u->a[0]>>32<<32)|(u->a[u->n-1]>>32);
+    while (l < r) {
+        m = (l + r)>>1;
+        if((p->fid[m]>>32) < (e>>32)) l = m + 1;
+        else r = m;
+    }
+    for (; l < p->n && (p->fid[l]>>32) == (e>>32); l++) {
+        k = (uint32_t)p->fid[l];
+        if(p->ends[k] == e && p->len[k] == u->len && p->len[k] > 0) return k;
+    }
+    return (uint64_t)-1;
+}
+
+///bring back u->s of unitigs released by ma_ug_pseq_gen(); unitigs are matched by their end reads rather than 
+///by index, since the graph may have been split and renumbered in between (e.g., break_phasing_utg())
+void ma_ug_pseq_restore(ma_ug_t *ug, const ma_ug_pseq_t *p)
+{
+    uint64_t i, k;
+    for (i = 0; i < ug->u.n; i++) {
+        if(ug->u.a[i].s) continue;
+        k = ma_ug_pseq_find(p, &(ug->u.a[i]));
+        if(k == (uint64_t)-1) continue;
+        MALLOC(ug->u.a[i].s, p->len[k] + 1);
+        ma_ug_pseq_retrieve(p, k, 0, 0, p->len[k], ug->u.a[i].s);
+        ug->u.a[i].s[p->len[k]] = '\0';
+    }
+}
+
 void asg_seq_set(asg_t *g, int sid, int len, int del)
 {
 	///just malloc size
@@ -1052,13 +1227,14 @@ void resize_ma_hit_t_alloc(ma_hit_t_alloc* x, uint32_t size)
 	if (size > x->size) {
 		x->size = size;
 		kroundup32(x->size);
+		if (graph_ckpt_mapped(x->buffer)) x->buffer = (ma_hit_t*)graph_ckpt_own(x->buffer, sizeof(ma_hit_t)*x->length);
 		REALLOC(x->buffer, x->size);
 	}
 }
 
 void destory_ma_hit_t_alloc(ma_hit_t_alloc* x)
 {
-	free(x->buffer);
+	if (!graph_ckpt_mapped(x->buffer)) free(x->buffer);
 }
 
 void add_ma_hit_t_alloc(ma_hit_t_alloc* x, ma_hit_t* element)
@@ -1066,6 +1242,7 @@ void add_ma_hit_t_alloc(ma_hit_t_alloc* x, ma_hit_t* element)
 	if (x->length + 1 > x->size) {
 		x->size = x->length + 1;
 		kroundup32(x->size);
+		if (graph_ckpt_mapped(x->buffer)) x->buffer = (ma_hit_t*)graph_ckpt_own(x->buffer, sizeof(ma_hit_t)*x->length);
 		REALLOC(x->buffer, x->size);
 	}
 	x->buffer[x->length++] = *element;
@@ -1200,67 +1377,102 @@ void normalize_ma_hit_t_single_side_advance(ma_hit_t_alloc* sources, long long n
 }
 
 
-typedef struct {
-	kvec_t_u64_warp *buf;
+typedef struct { // data structure for each step in kt_for()
+    ma_hit_t_alloc *buf; ///per-thread buffer of the missing reverse overlaps
     ma_hit_t_alloc* src;
     int64_t n_thread;
+    uint32_t recuse_el;
+    uint8_t *cmk;
+    ma_hit_t *add; ///all missing reverse overlaps, sorted by (qn, tn)
+    uint64_t *add_idx; ///add_idx[k]: start of the k-th qn group in add
 } ma_hit_t_aux;
 
+#define ma_hit_key_qn_tn(a) (((a).qns&0xffffffff00000000ULL)|((uint64_t)(a).tn))
+KRADIX_SORT_INIT(hit_qn_tn, ma_hit_t, ma_hit_key_qn_tn, 8)
+
+///the pair (qn, tn) is owned by min(qn, tn), so that each pair is touched by exactly one thread;
+///this gives the same result as the serial scan in normalize_ma_hit_t_single_side_advance()
 static void update_ma_hit_t_norm(void *data, long i, int tid) // callback for kt_for()
 {
 	ma_hit_t_aux *sl = (ma_hit_t_aux *)data;
-	ma_hit_t_alloc* src = sl->src;
+	ma_hit_t_alloc* src = sl->src; ma_hit_t *p, *r, e;
 	uint64_t z, qn, tn, is_del = 0; 
     int64_t idx, qLen_0, qLen_1;
 
-    for (z = 0; z < src[i].length; z++) {
-        qn = Get_qn(src[i].buffer[z]);
-        tn = Get_tn(src[i].buffer[z]);
-        is_del = 0; idx = get_specific_overlap(&(src[tn]), tn, qn);
-
-        if(idx != -1 && qn <= tn) { ///qn must be not equal to tn
-            if(src[i].buffer[z].del || src[tn].buffer[idx].del) is_del = 1;
-            qLen_0 = Get_qe(src[i].buffer[z]) - Get_qs(src[i].buffer[z]);
-            qLen_1 = Get_qe(src[tn].buffer[idx]) - Get_qs(src[tn].buffer[idx]);
+    for (z = 0; z < src[i].length; z++) {///src[*].length is not changed in this pass
+        p = &(src[i].buffer[z]);
+        qn = Get_qn(*p); tn = Get_tn(*p);
+        idx = get_specific_overlap(&(src[tn]), tn, qn);
 
-            if(qLen_0 == qLen_1) {
-                ///qn must be not equal to tn
-                ///make sources[qn] = sources[tn] if qn > tn
-                set_reverse_overlap(&(src[tn].buffer[idx]), &(src[i].buffer[z]));
+        if(idx != -1) {
+            if(qn > tn) continue;///qn == tn for self-overlaps
+            r = &(src[tn].buffer[idx]);
+            is_del = 0; if(p->del || r->del) is_del = 1;
+            qLen_0 = Get_qe(*p) - Get_qs(*p);
+            qLen_1 = Get_qe(*r) - Get_qs(*r);
+            ///the longer one wins; src[qn] wins the tie as qn < tn
+            if(qn < tn) {
+                if(qLen_0 >= qLen_1) set_reverse_overlap(r, p);
+                else set_reverse_overlap(p, r);
             }
-            else if(qLen_0 > qLen_1) {
-                set_reverse_overlap(&(src[tn].buffer[idx]), &(src[i].buffer[z]));
-            } else {
-                set_reverse_overlap(&(src[i].buffer[z]), &(src[tn].buffer[idx]));
-            }
-            
-            src[i].buffer[z].del = is_del; src[tn].buffer[idx].del = is_del;
-        }
-        else ///means this edge just occurs in one direction
-        {
-            tn = i; tn <<= 32; tn |= z;
-            kv_push(uint64_t, sl->buf[tid].a, tn);
-            src[i].buffer[z].del = 1;
+            if(sl->recuse_el && p->el && r->el) is_del = 0;
+            if(sl->cmk && (sl->cmk[qn] <= asm_opt.chemical_cov/**FORCE_CUT**/ || sl->cmk[tn] <= asm_opt.chemical_cov/**FORCE_CUT**/)) is_del = 1;
+            p->del = r->del = is_del;
+        } else {///means this edge just occurs in one direction
+            is_del = 1; memset(&e, 0, sizeof(e));
+            set_reverse_overlap(&e, p);
+            if(sl->recuse_el && p->el && e.el) is_del = 0;
+            if(sl->cmk && (sl->cmk[qn] <= asm_opt.chemical_cov/**FORCE_CUT**/ || sl->cmk[tn] <= asm_opt.chemical_cov/**FORCE_CUT**/)) is_del = 1;
+            p->del = e.del = is_del;
+            add_ma_hit_t_alloc(&(sl->buf[tid]), &e);
         }
     }
 }
 
-void normalize_ma_hit_t_single_side_advance_mult(ma_hit_t_alloc* src, int64_t n_src, int64_t n_thread)
+static void append_ma_hit_t_norm(void *data, long i, int tid) // callback for kt_for()
 {
-    ma_hit_t_aux aux; int64_t k; uint64_t z; ma_hit_t e;
-    aux.n_thread = n_thread; aux.src = src; CALLOC(aux.buf, aux.n_thread);
+	ma_hit_t_aux *sl = (ma_hit_t_aux *)data;
+    uint64_t k, s = sl->add_idx[i], e = sl->add_idx[i+1];
+    ma_hit_t_alloc *x = &(sl->src[Get_qn(sl->add[s])]);
+    resize_ma_hit_t_alloc(x, x->length + (e - s));
+    for (k = s; k < e; k++) x->buffer[x->length++] = sl->add[k];
+}
+
+void normalize_ma_hit_t_single_side_advance_mult(ma_hit_t_alloc* src, int64_t n_src, uint32_t recuse_el, uint8_t *cmk, int64_t n_thread)
+{
+    double startTime = Get_T();
+    ma_hit_t_aux aux; int64_t k; uint64_t z, n_add, n_grp;
+    memset(&aux, 0, sizeof(aux));
+    aux.n_thread = n_thread; aux.src = src; aux.recuse_el = recuse_el; aux.cmk = cmk; 
+    CALLOC(aux.buf, aux.n_thread);
 
     kt_for(aux.n_thread, update_ma_hit_t_norm, &aux, n_src);
 
-    for (k = 0; k < aux.n_thread; k++) {
-        for (z = 0; z < aux.buf[k].a.n; z++) {
-            set_reverse_overlap(&e, &(src[aux.buf[k].a.a[z]>>32].buffer[(uint32_t)(aux.buf[k].a.a[z])]));
-            src[aux.buf[k].a.a[z]>>32].buffer[(uint32_t)(aux.buf[k].a.a[z])].del = e.del = 1;
-            add_ma_hit_t_alloc(&(src[Get_qn(e)]), &e);
+    for (k = n_add = 0; k < aux.n_thread; k++) n_add += aux.buf[k].length;
+    if(n_add) {
+        ///the serial scan appends the missing overlaps of src[qn] in increasing tn
+        MALLOC(aux.add, n_add);
+        for (k = n_add = 0; k < aux.n_thread; k++) {
+            memcpy(aux.add + n_add, aux.buf[k].buffer, sizeof((*(aux.add)))*aux.buf[k].length);
+            n_add += aux.buf[k].length;
         }
-        free(aux.buf[k].a.a);
+        radix_sort_hit_qn_tn(aux.add, aux.add + n_add);
+        MALLOC(aux.add_idx, n_add + 1);
+        for (z = 1, n_grp = 0, aux.add_idx[n_grp++] = 0; z < n_add; z++) {
+            if(Get_qn(aux.add[z]) != Get_qn(aux.add[z-1])) aux.add_idx[n_grp++] = z;
+        }
+        aux.add_idx[n_grp] = n_add;
+        kt_for(aux.n_thread, append_ma_hit_t_norm, &aux, n_grp);
+        free(aux.add); free(aux.add_idx);
     }
+
+    for (k = 0; k < aux.n_thread; k++) free(aux.buf[k].buffer);
     free(aux.buf);
+
+    if(VERBOSE >= 1)
+    {
+        fprintf(stderr, "[M::%s] takes %0.2fs\n\n", __func__, Get_T()-startTime);
+    }
 }
 
 
@@ -10472,6 +10684,76 @@ ma_ug_t *gen_polished_ug(const ug_opt_t *uopt, asg_t *sg)
 }
 
 
+typedef struct { // data structure for each step in kt_for()
+    ma_ug_t *g;
+    asg_t *read_g;
+    const ma_sub_t *coverage_cut;
+    UC_Read *g_read, *tmp;
+    uint32_t is_scaf;
+} ug_seq_aux_t;
+
+static void worker_ug_seq(void *data, long i, int tid) // callback for kt_for()
+{
+    ug_seq_aux_t *aux = (ug_seq_aux_t*)data;
+    ma_utg_t *u = &(aux->g->u.a[i]);
+    asg_t *read_g = aux->read_g;
+    const ma_sub_t *coverage_cut = aux->coverage_cut;
+    UC_Read *g_read = &(aux->g_read[tid]), *tmp = &(aux->tmp[tid]);
+    uint32_t j, k, l, rId, ori, start, eLen, readLen;
+    char* readS = NULL;
+    if(u->m == 0) return;
+
+    u->s = (char*)calloc(1, u->len + 1);
+    memset(u->s, 'N', u->len);
+    for (j = l = 0; j < u->n; ++j) {
+        if(aux->is_scaf && u->a[j] == (uint64_t)-1) {
+            l += GAP_LEN;
+            continue;
+        }
+        rId = u->a[j]>>33;
+        ori = u->a[j]>>32&1;
+        start = l;
+        eLen = (uint32_t)u->a[j];
+        l += eLen;
+
+        if(eLen == 0) continue;
+        if(rId < read_g->r_seq) {
+            recover_UC_Read(g_read, &R_INF, rId);
+        } else {
+            recover_fake_read(g_read, tmp, &(read_g->F_seq[rId-read_g->r_seq]),
+            &R_INF, coverage_cut);
+        }
+
+        readS = g_read->seq + coverage_cut[rId].s;
+        readLen = coverage_cut[rId].e - coverage_cut[rId].s;
+        
+        if (!ori) {// forward strand
+            memcpy(u->s + start, readS, eLen);
+        } else {
+            for (k = 0; k < eLen; k++) {
+                uint8_t c = (uint8_t)readS[readLen - 1 - k];
+                u->s[start + k] = c >= 128? 'N' : comp_tab[c];
+            }
+        }
+    }
+}
+
+///fill u->s of all unitigs in parallel; polishing must have been done, as it edits the read graph
+static void ma_ug_seq_fill(ma_ug_t *g, asg_t *read_g, const ma_sub_t *coverage_cut, uint32_t is_scaf)
+{
+    ug_seq_aux_t aux; int t;
+    aux.g = g; aux.read_g = read_g; aux.coverage_cut = coverage_cut; aux.is_scaf = is_scaf;
+    MALLOC(aux.g_read, asm_opt.thread_num); MALLOC(aux.tmp, asm_opt.thread_num);
+    for (t = 0; t < asm_opt.thread_num; t++) {
+        init_UC_Read(&(aux.g_read[t])); init_UC_Read(&(aux.tmp[t]));
+    }
+    kt_for(asm_opt.thread_num, worker_ug_seq, &aux, g->u.n);
+    for (t = 0; t < asm_opt.thread_num; t++) {
+        destory_UC_Read(&(aux.g_read[t])); destory_UC_Read(&(aux.tmp[t]));
+    }
+    free(aux.g_read); free(aux.tmp);
+}
+
 // generate unitig sequences
 int ma_ug_seq(ma_ug_t *g, asg_t *read_g, ma_sub_t *coverage_cut, ma_hit_t_alloc* sources, 
 kvec_asg_arc_t_warp* edge, int max_hang, int min_ovlp, kvec_asg_arc_t_warp *E, uint32_t is_polish)
@@ -10481,9 +10763,7 @@ kvec_asg_arc_t_warp* edge, int max_hang, int min_ovlp, kvec_asg_arc_t_warp *E, u
     UC_Read tmp;
     init_UC_Read(&tmp);
 	///utg_intv_t *tmp;
-	uint32_t i, j, k;
-    uint32_t rId, /**uId,**/ori, start, eLen, readLen;
-    char* readS = NULL;
+	uint32_t i, k;
     
     ///why we need n_read here? it is just beacuse one read can only be included in one untig
     ///but it is not true
@@ -10498,44 +10778,11 @@ kvec_asg_arc_t_warp* edge, int max_hang, int min_ovlp, kvec_asg_arc_t_warp *E, u
         }
         
         g->g->seq[i].len = u->len;
-
-		uint32_t l = 0;
-		u->s = (char*)calloc(1, u->len + 1);
-		memset(u->s, 'N', u->len);
-		for (j = 0; j < u->n; ++j) {
-            rId = u->a[j]>>33;
-            ///uId = i;
-            ori = u->a[j]>>32&1;
-            start = l;
-            eLen = (uint32_t)u->a[j];
-			l += eLen;
-
-            if(eLen == 0) continue;
-            if(rId < read_g->r_seq) {
-                recover_UC_Read(&g_read, &R_INF, rId);
-            } else {
-                recover_fake_read(&g_read, &tmp, &(read_g->F_seq[rId-read_g->r_seq]),
-                &R_INF, coverage_cut);
-            }
-
-            readS = g_read.seq + coverage_cut[rId].s;
-            readLen = coverage_cut[rId].e - coverage_cut[rId].s;
-            
-            if (!ori) {// forward strand
-                for (k = 0; k < eLen; k++) {
-                    u->s[start + k] = readS[k];
-                }
-            } else {
-                for (k = 0; k < eLen; k++) {
-                    uint8_t c = (uint8_t)readS[readLen - 1 - k];
-                    u->s[start + k] = c >= 128? 'N' : comp_tab[c];
-                }
-            }
-		}
 	}
 
     destory_UC_Read(&g_read);
     destory_UC_Read(&tmp);
+    ma_ug_seq_fill(g, read_g, coverage_cut, 0);
 
 
     uint32_t n_vtx = g->g->n_seq * 2, v, nv;
@@ -10640,9 +10887,7 @@ kvec_asg_arc_t_warp* edge, int max_hang, int min_ovlp, kvec_asg_arc_t_warp *E, u
     UC_Read tmp;
     init_UC_Read(&tmp);
 	///utg_intv_t *tmp;
-	uint32_t i, j, k;
-    uint32_t rId, /**uId,**/ori, start, eLen, readLen;
-    char* readS = NULL;
+	uint32_t i, k;
     if(!(g->g))
     {
         g->g = asg_init();
@@ -10663,58 +10908,11 @@ kvec_asg_arc_t_warp* edge, int max_hang, int min_ovlp, kvec_asg_arc_t_warp *E, u
         if(u->m == 0) continue;
         if(is_polish) polish_unitig_scaffold(i, u, read_g, &R_INF, sources, coverage_cut, edge, &g_read, &tmp, max_hang, min_ovlp, E);
         g->g->seq[i].len = u->len;
-
-		uint32_t l = 0;
-		u->s = (char*)calloc(1, u->len + 1);
-		memset(u->s, 'N', u->len);
-		for (j = 0; j < u->n; ++j) {
-            // fprintf(stderr, "j=%u, u->a[j]: %lu\n", j, u->a[j]);
-            if(u->a[j] == (uint64_t)-1)
-            {
-                l += GAP_LEN;
-                continue;
-            }
-            rId = u->a[j]>>33;
-            ///uId = i;
-            ori = u->a[j]>>32&1;
-            start = l;
-            eLen = (uint32_t)u->a[j];
-			l += eLen;
-
-            if(eLen == 0) continue;
-            if(rId < read_g->r_seq)
-            {
-                recover_UC_Read(&g_read, &R_INF, rId);
-            }
-            else
-            {
-                recover_fake_read(&g_read, &tmp, &(read_g->F_seq[rId-read_g->r_seq]),
-                &R_INF, coverage_cut);
-            }
-
-            readS = g_read.seq + coverage_cut[rId].s;
-            readLen = coverage_cut[rId].e - coverage_cut[rId].s;
-            
-            if (!ori) // forward strand
-            {
-                for (k = 0; k < eLen; k++)
-                {
-                    u->s[start + k] = readS[k];
-                }
-            }
-            else
-            {
-                for (k = 0; k < eLen; k++)
-                {
-                    uint8_t c = (uint8_t)readS[readLen - 1 - k];
-                    u->s[start + k] = c >= 128? 'N' : comp_tab[c];
-                }
-            }
-		}
 	}
 
     destory_UC_Read(&g_read);
     destory_UC_Read(&tmp);
+    ma_ug_seq_fill(g, read_g, coverage_cut, 1);
 
 
     uint32_t n_vtx = g->g->n_seq * 2, v, nv;
@@ -10909,46 +11107,122 @@ uint32_t cal_circle_ov(const ma_ug_t *ug, uint32_t uid, uint32_t rev, asg_t *sg)
     return 0;
 }
 
-void ma_ug_print2(const ma_ug_t *ug, All_reads *RNF, asg_t* read_g, const ma_sub_t *coverage_cut, 
-ma_hit_t_alloc* sources, R_to_U* ruIndex, int print_seq, const char* prefix, FILE *fp)
+#define UG_PRINT_BLOCK (1ULL<<28)
+
+typedef struct { size_t n, m; char *a; } ug_pbuf_t;
+
+static void ug_pbuf_printf(ug_pbuf_t *b, const char *fmt, ...)
 {
-    uint8_t* primary_flag = read_g?(uint8_t*)calloc(read_g->n_seq, sizeof(uint8_t)):NULL;
-	uint32_t i, j, l, pc = read_g && coverage_cut && sources && ruIndex?1:0, co;
-	char name[32];
-	for (i = 0; i < ug->u.n; ++i) { // the Segment lines in GFA
-		ma_utg_t *p = &ug->u.a[i];
-        if(p->m == 0) continue;
-        sprintf(name, "%s%.6d%c", prefix, i + 1, "lc"[p->circ]);
-		if (print_seq) fprintf(fp, "S\t%s\t%s\tLN:i:%d\trd:i:%u\n", name, p->s? p->s : "*", p->len, 
-        pc?get_ug_coverage(p, read_g, coverage_cut, sources, ruIndex, primary_flag, NULL, NULL):0);
-		else fprintf(fp, "S\t%s\t*\tLN:i:%d\trd:i:%u\n", name, p->len, 
-        pc?get_ug_coverage(p, read_g, coverage_cut, sources, ruIndex, primary_flag, NULL, NULL):0);
-        
-		for (j = l = 0; j < p->n; j++) {
-            if(p->a[j] != (uint64_t)-1)
+    va_list ap; int l;
+    while (1) {
+        va_start(ap, fmt);
+        l = vsnprintf(b->a + b->n, b->m - b->n, fmt, ap);
+        va_end(ap);
+        if (b->n + l < b->m) break;
+        b->m = b->n + l + 1; b->m += b->m>>1;
+        REALLOC(b->a, b->m);
+    }
+    b->n += l;
+}
+
+static void ug_pbuf_write(ug_pbuf_t *b, const char *x, size_t l)
+{
+    if (b->n + l + 1 > b->m) {
+        b->m = b->n + l + 1; b->m += b->m>>1;
+        REALLOC(b->a, b->m);
+    }
+    memcpy(b->a + b->n, x, l); b->n += l;
+}
+
+typedef struct { // data structure for each step in kt_for()
+    const ma_ug_t *ug;
+    All_reads *RNF;
+    const ma_sub_t *coverage_cut;
+    const char* prefix;
+    int print_seq;
+    uint64_t s;
+    uint32_t *rd;
+    ug_pbuf_t *buf;
+} ug_print_aux_t;
+
+static void worker_ug_print(void *data, long i, int tid) // callback for kt_for()
+{
+    ug_print_aux_t *aux = (ug_print_aux_t*)data;
+    All_reads *RNF = aux->RNF;
+    const ma_sub_t *coverage_cut = aux->coverage_cut;
+    ma_utg_t *p = &(aux->ug->u.a[aux->s + i]);
+    ug_pbuf_t *b = &(aux->buf[i]);
+    uint32_t j, l;
+    char name[32];
+    b->n = 0;
+    if(p->m == 0) return;
+    sprintf(name, "%s%.6lu%c", aux->prefix, (unsigned long)(aux->s + i + 1), "lc"[p->circ]);
+    if (aux->print_seq) {
+        ug_pbuf_printf(b, "S\t%s\t", name);
+        if(p->s) ug_pbuf_write(b, p->s, strlen(p->s));
+        else ug_pbuf_write(b, "*", 1);
+        ug_pbuf_printf(b, "\tLN:i:%d\trd:i:%u\n", p->len, aux->rd[i]);
+    } else {
+        ug_pbuf_printf(b, "S\t%s\t*\tLN:i:%d\trd:i:%u\n", name, p->len, aux->rd[i]);
+    }
+
+    for (j = l = 0; j < p->n; j++) {
+        if(p->a[j] != (uint64_t)-1)
+        {
+            uint32_t x = p->a[j]>>33;
+            if(x<RNF->total_reads)
             {
-                uint32_t x = p->a[j]>>33;
-                if(x<RNF->total_reads)
-                {
 
-                    fprintf(fp, "A\t%s\t%d\t%c\t%.*s\t%d\t%d\tid:i:%d\tHG:A:%c\n", name, l, "+-"[p->a[j]>>32&1],
-                    (int)Get_NAME_LENGTH((*RNF), x), Get_NAME((*RNF), x), 
-                    coverage_cut?coverage_cut[x].s:0, coverage_cut?coverage_cut[x].e:(int)Get_READ_LENGTH((*RNF), x), x, 
-                    "apmaaa"[((RNF->trio_flag[x]!=FATHER && RNF->trio_flag[x]!=MOTHER)?AMBIGU:RNF->trio_flag[x])]);
-                }
-                else
-                {
-                    fprintf(fp, "A\t%s\t%d\t%c\t%s\t%d\t%d\tid:i:%d\tHG:A:%c\n", name, l, "+-"[p->a[j]>>32&1],
-                        "FAKE", coverage_cut?coverage_cut[x].s:0, coverage_cut?coverage_cut[x].e:(int)Get_READ_LENGTH((*RNF), x), x, '*');
-                }
+                ug_pbuf_printf(b, "A\t%s\t%d\t%c\t%.*s\t%d\t%d\tid:i:%d\tHG:A:%c\n", name, l, "+-"[p->a[j]>>32&1],
+                (int)Get_NAME_LENGTH((*RNF), x), Get_NAME((*RNF), x), 
+                coverage_cut?coverage_cut[x].s:0, coverage_cut?coverage_cut[x].e:(int)Get_READ_LENGTH((*RNF), x), x, 
+                "apmaaa"[((RNF->trio_flag[x]!=FATHER && RNF->trio_flag[x]!=MOTHER)?AMBIGU:RNF->trio_flag[x])]);
             }
             else
             {
-                fprintf(fp, "A\t%s\t%d\t*\t*\t*\t*\tid:i:*\tHG:A:*\n", name, l);
+                ug_pbuf_printf(b, "A\t%s\t%d\t%c\t%s\t%d\t%d\tid:i:%d\tHG:A:%c\n", name, l, "+-"[p->a[j]>>32&1],
+                    "FAKE", coverage_cut?coverage_cut[x].s:0, coverage_cut?coverage_cut[x].e:(int)Get_READ_LENGTH((*RNF), x), x, '*');
             }
-            l += (uint32_t)p->a[j];
         }
-	}
+        else
+        {
+            ug_pbuf_printf(b, "A\t%s\t%d\t*\t*\t*\t*\tid:i:*\tHG:A:*\n", name, l);
+        }
+        l += (uint32_t)p->a[j];
+    }
+}
+
+void ma_ug_print2(const ma_ug_t *ug, All_reads *RNF, asg_t* read_g, const ma_sub_t *coverage_cut, 
+ma_hit_t_alloc* sources, R_to_U* ruIndex, int print_seq, const char* prefix, FILE *fp)
+{
+    uint8_t* primary_flag = read_g?(uint8_t*)calloc(read_g->n_seq, sizeof(uint8_t)):NULL;
+	uint32_t i, j, pc = read_g && coverage_cut && sources && ruIndex?1:0, co;
+    uint64_t e, bs, m_buf = 0;
+    ug_print_aux_t aux;
+    aux.ug = ug; aux.RNF = RNF; aux.coverage_cut = coverage_cut; aux.prefix = prefix; aux.print_seq = print_seq;
+    aux.rd = NULL; aux.buf = NULL;
+    ///the Segment lines in GFA are formatted in parallel, one block of unitigs at a time, and written in order
+    for (aux.s = 0; aux.s < ug->u.n; aux.s = e) {
+        for (e = aux.s, bs = 0; e < ug->u.n && (e == aux.s || bs < UG_PRINT_BLOCK); e++) {
+            bs += (print_seq?ug->u.a[e].len:0) + ((uint64_t)ug->u.a[e].n<<7) + 128;
+        }
+        if (e - aux.s > m_buf) {
+            REALLOC(aux.buf, e - aux.s); REALLOC(aux.rd, e - aux.s);
+            memset(aux.buf + m_buf, 0, sizeof(*(aux.buf))*(e - aux.s - m_buf));
+            m_buf = e - aux.s;
+        }
+        ///get_ug_coverage() needs a shared flag array, so it is cheaper to do it here
+        for (i = aux.s; i < e; i++) {
+            aux.rd[i-aux.s] = (pc&&ug->u.a[i].m)?get_ug_coverage(&(ug->u.a[i]), read_g, coverage_cut, sources, ruIndex, primary_flag, NULL, NULL):0;
+        }
+        kt_for(asm_opt.thread_num, worker_ug_print, &aux, e - aux.s);
+        for (i = aux.s; i < e; i++) {
+            if (aux.buf[i-aux.s].n) fwrite(aux.buf[i-aux.s].a, 1, aux.buf[i-aux.s].n, fp);
+        }
+    }
+    for (i = 0; i < m_buf; i++) free(aux.buf[i].a);
+    free(aux.buf); free(aux.rd);
+
 	// for (i = 0; i < ug->g->n_arc; ++i) { // the Link lines in GFA
 	// 	uint32_t u = ug->g->arc[i].ul>>32, v = ug->g->arc[i].v;
 	// 	fprintf(fp, "L\t%s%.6d%c\t%c\t%s%.6d%c\t%c\t%dM\tL1:i:%d\n", 
@@ -11026,7 +11300,7 @@ void ma_scg_print(const kvect_sec_t *sc, All_reads *RNF, asg_t* read_g, const ma
 {
     uint8_t* primary_flag = read_g?(uint8_t*)calloc(read_g->n_seq, sizeof(uint8_t)):NULL;
 	uint64_t i, j, l, pc = read_g && coverage_cut && sources && ruIndex?1:0, tl, m, x; sec_t *scp;
-	char name[32]; uint64_t Rb, Cb, tRb, tCb, Cov; ma_utg_t *z = NULL; uint8_t c;
+	char name[32]; uint64_t Rb, Cb, tRb, tCb, Cov; ma_utg_t *z = NULL; uint8_t c; ug_pbuf_t sb = {0, 0, NULL};
 	for (i = 0; i < sc->n; ++i) { // the Segment lines in GFA
         scp = &(sc->a[i]);
         ///debug
@@ -11045,16 +11319,18 @@ void ma_scg_print(const kvect_sec_t *sc, All_reads *RNF, asg_t* read_g, const ma
         } else {
             fprintf(fp, "S\t%s\t", name);
             for (j = 0; j < scp->n; j++) {
-                z = &(sc->ctg->u.a[((uint32_t)scp->a[j])>>1]); 
+                z = &(sc->ctg->u.a[((uint32_t)scp->a[j])>>1]); sb.n = 0;
                 if(!(((uint32_t)scp->a[j])&1)) {
-                    fprintf(fp, "%s", z->s);
+                    fputs(z->s, fp);
                 } else {
+                    if(sb.m < z->len) sb.m = z->len, REALLOC(sb.a, sb.m);
                     for(l = 0; l < z->len; l++) {
                         c = (uint8_t)(z->s[z->len-1-l]);
-                        fprintf(fp, "%c", ((c>=128)?'N':comp_tab[c]));
+                        sb.a[sb.n++] = ((c>=128)?'N':comp_tab[c]);
                     }
+                    fwrite(sb.a, 1, sb.n, fp);
                 }
-                for(l = 0; l < (scp->a[j]>>32); l++) fprintf(fp, "N");
+                for(l = 0; l < (scp->a[j]>>32); l++) fputc('N', fp);
             }
             fprintf(fp, "\tLN:i:%lu\trd:i:%lu\n", tl, Cov);
         }
@@ -11098,7 +11374,7 @@ void ma_scg_print(const kvect_sec_t *sc, All_reads *RNF, asg_t* read_g, const ma
             tl += (scp->a[j]>>32);
         }
 	}
-    free(primary_flag);    
+    free(primary_flag); free(sb.a);
 }
 
 int asg_cut_internal(asg_t *g, int max_ext)
@@ -14751,6 +15027,48 @@ void write_dbug(ma_ug_t* ug, FILE* fp)
     }
 }
 
+static inline uint64_t ug_hash_mix(uint64_t h, uint64_t x)
+{
+    h ^= x; h += 0x9e3779b97f4a7c15ULL;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+///signature of the same unitig fields checked by test_dbug(); used to detect stale files
+uint64_t ma_ug_hash(ma_ug_t* ug)
+{
+    ma_utg_t *u = NULL;
+    uint64_t i, k, h = ug_hash_mix(0, ug->u.n);
+    for (i = 0; i < ug->u.n; i++)
+    {
+        u = &(ug->u.a[i]);
+        h = ug_hash_mix(h, ((uint64_t)u->len<<32)|u->circ);
+        h = ug_hash_mix(h, ((uint64_t)u->start<<32)|u->end);
+        h = ug_hash_mix(h, u->n);
+        for (k = 0; k < u->n; k++) h = ug_hash_mix(h, u->a[k]);
+    }
+    return h;
+}
+
+///signature of the overlaps of all reads; cc is not kept in *.ovlp.*.bin and is not hashed
+uint64_t ma_hit_hash(ma_hit_t_alloc *x, uint64_t n_read)
+{
+    uint64_t i, k, h = ug_hash_mix(0, n_read); ma_hit_t *p;
+    for (i = 0; i < n_read; i++) {
+        h = ug_hash_mix(h, ((uint64_t)x[i].length<<16)|((uint64_t)x[i].is_fully_corrected<<8)|x[i].is_abnormal);
+        for (k = 0; k < x[i].length; k++) {
+            p = &(x[i].buffer[k]);
+            h = ug_hash_mix(h, p->qns);
+            h = ug_hash_mix(h, ((uint64_t)p->qe<<32)|p->tn);
+            h = ug_hash_mix(h, ((uint64_t)p->ts<<32)|p->te);
+            h = ug_hash_mix(h, ((uint64_t)p->ml<<33)|((uint64_t)p->rev<<32)|((uint64_t)p->bl<<1)|p->del);
+            h = ug_hash_mix(h, ((uint64_t)p->el<<8)|p->no_l_indel);
+        }
+    }
+    return h;
+}
+
 void filter_u_trans(kv_u_trans_t *ta, uint8_t keep_bub, uint8_t keep_topo, uint8_t keep_read, uint8_t keep_base)
 {
     if(keep_bub && keep_topo && keep_read && keep_base) return;
@@ -22951,16 +23269,19 @@ scaf_res_t *merge_scaf_res(scaf_res_t *in0, scaf_res_t *in1)
         *m = *s;
 
         m->r_base.a = NULL; 
+        if(s->pg&UL_PG_RB) m->r_base.m = m->r_base.n;///paged bases
         if(m->r_base.m) {
             MALLOC(m->r_base.a, m->r_base.m);
             memcpy(m->r_base.a, s->r_base.a, sizeof((*(m->r_base.a)))*m->r_base.m);
         }
 
         m->bb.a = NULL; 
+        if(s->pg&UL_PG_BB) m->bb.m = m->bb.n;///paged blocks
         if(m->bb.m) {
             MALLOC(m->bb.a, m->bb.m);
             memcpy(m->bb.a, s->bb.a, sizeof((*(m->bb.a)))*m->bb.m);
         }
+        m->pg = 0;
 
         m->N_site.a = NULL; 
         if(m->N_site.m) {
@@ -22974,16 +23295,19 @@ scaf_res_t *merge_scaf_res(scaf_res_t *in0, scaf_res_t *in1)
         *m = *s;
 
         m->r_base.a = NULL; 
+        if(s->pg&UL_PG_RB) m->r_base.m = m->r_base.n;///paged bases
         if(m->r_base.m) {
             MALLOC(m->r_base.a, m->r_base.m);
             memcpy(m->r_base.a, s->r_base.a, sizeof((*(m->r_base.a)))*m->r_base.m);
         }
 
         m->bb.a = NULL; 
+        if(s->pg&UL_PG_BB) m->bb.m = m->bb.n;///paged blocks
         if(m->bb.m) {
             MALLOC(m->bb.a, m->bb.m);
             memcpy(m->bb.a, s->bb.a, sizeof((*(m->bb.a)))*m->bb.m);
         }
+        m->pg = 0;
 
         m->N_site.a = NULL; 
         if(m->N_site.m) {
@@ -31907,6 +32231,208 @@ int load_asg_t(asg_t **sg, char* read_file_name)
     return 1;
 }
 
+///versioned single-file checkpoint of the cleaned string graph and of everything the later stages read
+///from the cleaning steps; every section starts at an 8-byte aligned offset so that it can be used in place
+#define GRAPH_CKPT_MAGIC "HAGC"
+#define GRAPH_CKPT_VER 3
+#define GRAPH_CKPT_SEQ 0
+#define GRAPH_CKPT_IDX 1
+#define GRAPH_CKPT_ARC 2
+#define GRAPH_CKPT_VIS 3
+#define GRAPH_CKPT_COV 4
+#define GRAPH_CKPT_RU 5
+#define GRAPH_CKPT_TRIO 6
+#define GRAPH_CKPT_SRC_N 7
+#define GRAPH_CKPT_SRC 8
+#define GRAPH_CKPT_REV_N 9
+#define GRAPH_CKPT_REV 10
+#define GRAPH_CKPT_N 11
+#define GRAPH_CKPT_HS 3
+
+typedef struct {
+    char magic[4];
+    uint32_t ver;
+    uint64_t n_read; ///R_INF.total_reads, used to reject checkpoints of other read sets
+    uint32_t n_seq, r_seq, n_arc, is_srt:1, is_symm:1;
+    int32_t hom_cov, hom_cov_set;
+    uint64_t ru_len;
+    uint64_t hs[GRAPH_CKPT_HS]; ///see graph_ckpt_hash()
+    uint64_t off[GRAPH_CKPT_N], size[GRAPH_CKPT_N];
+} graph_ckpt_hdr_t;
+
+///the mapping of a loaded checkpoint; it is kept until exit as sections are used in place
+static uint8_t *graph_ckpt_a = NULL;
+static uint64_t graph_ckpt_n = 0;
+
+///if p points into a loaded checkpoint, it must not be passed to free() or realloc()
+int graph_ckpt_mapped(const void *p)
+{
+    return graph_ckpt_a && (const uint8_t*)p >= graph_ckpt_a && (const uint8_t*)p < graph_ckpt_a + graph_ckpt_n;
+}
+
+///copy a section used in place out of the checkpoint, so that it can be grown or freed
+void *graph_ckpt_own(const void *p, uint64_t size)
+{
+    void *a = malloc(size);
+    memcpy(a, p, size);
+    return a;
+}
+
+///hs[0]: overlaps the graph is cleaned from; hs[1]: options of the cleaning steps; hs[2]: Hi-C file names and sizes
+void graph_ckpt_hash(ma_hit_t_alloc* sources, ma_hit_t_alloc* reverse_sources, uint64_t n_read, uint64_t *hs)
+{
+    struct stat st; int32_t i, k; const char *c;
+    hs[0] = ug_hash_mix(ma_hit_hash(sources, n_read), ma_hit_hash(reverse_sources, n_read));
+    hs[1] = ug_hash_mix(0, GRAPH_CKPT_VER);
+    hs[1] = ug_hash_mix(hs[1], ug_ext_len);
+    hs[1] = ug_hash_mix(hs[1], ha_opt_triobin(&asm_opt));
+    hs[1] = ug_hash_mix(hs[1], ((uint64_t)asm_opt.k_mer_length<<32)|(uint32_t)asm_opt.hic_mer_length);
+    hs[1] = ug_hash_mix(hs[1], ((uint64_t)asm_opt.max_short_tip<<32)|(uint32_t)asm_opt.polyploidy);
+    hs[1] = ug_hash_mix(hs[1], ((uint64_t)asm_opt.max_hang_Len<<32)|(uint32_t)asm_opt.min_overlap_Len);
+    hs[1] = ug_hash_mix(hs[1], ((uint64_t)asm_opt.clean_round<<32)|(uint32_t)asm_opt.gap_fuzz);
+    hs[1] = ug_hash_mix(hs[1], ((uint64_t)(asm_opt.max_drop_rate*1e6)<<32)|(uint32_t)(asm_opt.min_drop_rate*1e6));
+    hs[1] = ug_hash_mix(hs[1], (uint32_t)asm_opt.hom_global_coverage);
+    hs[1] = ug_hash_mix(hs[1], asm_opt.flag);
+    hs[2] = ug_hash_mix(0, !!ha_opt_hic(&asm_opt));
+    for (k = 0; k < 2 && ha_opt_hic(&asm_opt); k++) {
+        for (i = 0; i < asm_opt.hic_reads[k]->n; i++) {
+            hs[2] = ug_hash_mix(hs[2], ug_hash_mix(0, i));
+            for (c = asm_opt.hic_reads[k]->a[i]; *c; c++) hs[2] = ug_hash_mix(hs[2], (uint8_t)*c);
+            hs[2] = ug_hash_mix(hs[2], stat(asm_opt.hic_reads[k]->a[i], &st) == 0? (uint64_t)st.st_size : (uint64_t)-1);
+        }
+    }
+}
+
+static void write_ckpt_sec(FILE *fp, graph_ckpt_hdr_t *h, uint32_t id, const void *a, uint64_t size)
+{
+    static const uint8_t pad[8] = {0};
+    long p = ftell(fp);
+    if(p&7) fwrite(pad, 1, 8-(p&7), fp), p += 8-(p&7);
+    h->off[id] = p; h->size[id] = size;
+    if(size) fwrite(a, 1, size, fp);
+}
+
+///per-read counts and flags, then all overlaps back to back
+static void write_ckpt_hits(FILE *fp, graph_ckpt_hdr_t *h, uint32_t id_n, uint32_t id_a, ma_hit_t_alloc *x, uint64_t n_read)
+{
+    uint64_t i, *n, tot;
+    MALLOC(n, n_read);
+    for (i = tot = 0; i < n_read; i++) {
+        n[i] = x[i].length|((uint64_t)x[i].is_fully_corrected<<32)|((uint64_t)x[i].is_abnormal<<40);
+        tot += x[i].length;
+    }
+    write_ckpt_sec(fp, h, id_n, n, sizeof((*n))*n_read);
+    write_ckpt_sec(fp, h, id_a, NULL, 0);
+    for (i = 0; i < n_read; i++) {
+        if(x[i].length) fwrite(x[i].buffer, sizeof((*(x[i].buffer))), x[i].length, fp);
+    }
+    h->size[id_a] = sizeof((*(x[0].buffer)))*tot;
+    free(n);
+}
+
+int write_graph_ckpt(const char *fn, asg_t *sg, ma_hit_t_alloc *sources, ma_hit_t_alloc *reverse_sources, 
+ma_sub_t *coverage_cut, R_to_U *ruIndex, const uint64_t *hs)
+{
+    graph_ckpt_hdr_t h; FILE *fp = fopen(fn, "wb");
+    if(!fp) return 0;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.hs, hs, sizeof(h.hs));
+    memcpy(h.magic, GRAPH_CKPT_MAGIC, 4); h.ver = GRAPH_CKPT_VER; h.n_read = R_INF.total_reads;
+    h.hom_cov = asm_opt.hom_global_coverage; h.hom_cov_set = asm_opt.hom_global_coverage_set;
+    h.n_seq = sg->n_seq; h.r_seq = sg->r_seq; h.n_arc = sg->n_arc;
+    h.is_srt = sg->is_srt; h.is_symm = sg->is_symm;
+    h.ru_len = ruIndex->len;
+    fwrite(&h, sizeof(h), 1, fp);///placeholder; rewritten once the offsets are known
+    write_ckpt_sec(fp, &h, GRAPH_CKPT_SEQ, sg->seq, sizeof((*(sg->seq)))*sg->n_seq);
+    write_ckpt_sec(fp, &h, GRAPH_CKPT_IDX, sg->idx, sg->idx?sizeof((*(sg->idx)))*sg->n_seq*2:0);
+    write_ckpt_sec(fp, &h, GRAPH_CKPT_ARC, sg->arc, sizeof((*(sg->arc)))*sg->n_arc);
+    write_ckpt_sec(fp, &h, GRAPH_CKPT_VIS, sg->seq_vis, sg->seq_vis?sizeof((*(sg->seq_vis)))*sg->n_seq*2:0);
+    write_ckpt_sec(fp, &h, GRAPH_CKPT_COV, coverage_cut, sizeof((*coverage_cut))*R_INF.total_reads);
+    write_ckpt_sec(fp, &h, GRAPH_CKPT_RU, ruIndex->index, sizeof((*(ruIndex->index)))*ruIndex->len);
+    write_ckpt_sec(fp, &h, GRAPH_CKPT_TRIO, R_INF.trio_flag, sizeof((*(R_INF.trio_flag)))*R_INF.total_reads);
+    write_ckpt_hits(fp, &h, GRAPH_CKPT_SRC_N, GRAPH_CKPT_SRC, sources, R_INF.total_reads);
+    write_ckpt_hits(fp, &h, GRAPH_CKPT_REV_N, GRAPH_CKPT_REV, reverse_sources, R_INF.total_reads);
+    fseek(fp, 0, SEEK_SET);
+    fwrite(&h, sizeof(h), 1, fp);
+    fclose(fp);
+    return 1;
+}
+
+///mmap() the checkpoint and validate it; the mapping is writable copy-on-write
+static graph_ckpt_hdr_t *map_graph_ckpt(const char *fn, uint64_t *map_size)
+{
+    struct stat st; void *a; graph_ckpt_hdr_t *h; uint32_t k;
+    int fd = open(fn, O_RDONLY);
+    if(fd < 0) return NULL;
+    if(fstat(fd, &st) < 0 || (uint64_t)st.st_size < sizeof(graph_ckpt_hdr_t)) {
+        close(fd); return NULL;
+    }
+    a = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0); close(fd);
+    if(a == MAP_FAILED) return NULL;
+    h = (graph_ckpt_hdr_t*)a;
+    for (k = 0; k < GRAPH_CKPT_N && h->off[k] + h->size[k] <= (uint64_t)st.st_size; k++);
+    if(memcmp(h->magic, GRAPH_CKPT_MAGIC, 4) || h->ver != GRAPH_CKPT_VER || h->n_read != R_INF.total_reads || k < GRAPH_CKPT_N) {
+        fprintf(stderr, "[M::%s] %s is not a compatible graph checkpoint\n", __func__, fn);
+        munmap(a, st.st_size); return NULL;
+    }
+    (*map_size) = st.st_size;
+    return h;
+}
+
+#define ckpt_sec(h, id) ((void*)(((uint8_t*)(h)) + (h)->off[(id)]))
+
+static void load_ckpt_hits(graph_ckpt_hdr_t *h, uint32_t id_n, uint32_t id_a, ma_hit_t_alloc *x, uint64_t n_read)
+{
+    uint64_t i, *n = (uint64_t*)ckpt_sec(h, id_n); ma_hit_t *a = (ma_hit_t*)ckpt_sec(h, id_a);
+    for (i = 0; i < n_read; i++) {
+        destory_ma_hit_t_alloc(&(x[i]));
+        x[i].length = x[i].size = (uint32_t)n[i];
+        x[i].is_fully_corrected = (n[i]>>32)&0xff; x[i].is_abnormal = (n[i]>>40)&0xff;
+        x[i].buffer = x[i].length? a : NULL; a += x[i].length;
+    }
+}
+
+///the string graph is copied out, as the later stages free its index and grow its arcs piecewise;
+///the overlaps, coverage cuts, R_to_U and trio flags are used in place (see graph_ckpt_mapped())
+int load_graph_ckpt(const char *fn, asg_t **sg, ma_hit_t_alloc *sources, ma_hit_t_alloc *reverse_sources, 
+ma_sub_t **coverage_cut, R_to_U *ruIndex, const uint64_t *hs)
+{
+    uint64_t map_size = 0; graph_ckpt_hdr_t *h; asg_t *g;
+    if(graph_ckpt_a) return 0;
+    h = map_graph_ckpt(fn, &map_size);
+    if(!h) return 0;
+    if(memcmp(h->hs, hs, sizeof(h->hs))) {
+        fprintf(stderr, "[M::%s] %s was written from other overlaps, options or Hi-C input; ignored\n", __func__, fn);
+        munmap(h, map_size); return 0;
+    }
+    graph_ckpt_a = (uint8_t*)h; graph_ckpt_n = map_size;
+
+    g = asg_init();
+    g->n_seq = g->m_seq = h->n_seq; g->r_seq = h->r_seq; g->n_arc = g->m_arc = h->n_arc;
+    g->is_srt = h->is_srt; g->is_symm = h->is_symm;
+    MALLOC(g->seq, g->m_seq); memcpy(g->seq, ckpt_sec(h, GRAPH_CKPT_SEQ), h->size[GRAPH_CKPT_SEQ]);
+    MALLOC(g->arc, g->m_arc); memcpy(g->arc, ckpt_sec(h, GRAPH_CKPT_ARC), h->size[GRAPH_CKPT_ARC]);
+    if(h->size[GRAPH_CKPT_IDX]) {
+        MALLOC(g->idx, g->n_seq*2); memcpy(g->idx, ckpt_sec(h, GRAPH_CKPT_IDX), h->size[GRAPH_CKPT_IDX]);
+    }
+    if(h->size[GRAPH_CKPT_VIS]) {
+        MALLOC(g->seq_vis, g->n_seq*2); memcpy(g->seq_vis, ckpt_sec(h, GRAPH_CKPT_VIS), h->size[GRAPH_CKPT_VIS]);
+    }
+    if(*sg) asg_destroy(*sg);
+    (*sg) = g;
+
+    if(*coverage_cut && !graph_ckpt_mapped(*coverage_cut)) free(*coverage_cut);
+    (*coverage_cut) = (ma_sub_t*)ckpt_sec(h, GRAPH_CKPT_COV);
+    destory_R_to_U(ruIndex);
+    ruIndex->len = h->ru_len; ruIndex->index = (uint32_t*)ckpt_sec(h, GRAPH_CKPT_RU);
+    if(!graph_ckpt_mapped(R_INF.trio_flag)) free(R_INF.trio_flag);
+    R_INF.trio_flag = (uint8_t*)ckpt_sec(h, GRAPH_CKPT_TRIO);
+    load_ckpt_hits(h, GRAPH_CKPT_SRC_N, GRAPH_CKPT_SRC, sources, h->n_read);
+    load_ckpt_hits(h, GRAPH_CKPT_REV_N, GRAPH_CKPT_REV, reverse_sources, h->n_read);
+    asm_opt.hom_global_coverage = h->hom_cov; asm_opt.hom_global_coverage_set = h->hom_cov_set;
+    return 1;
+}
+
 int write_debug_graph(asg_t *sg, ma_hit_t_alloc* sources, ma_sub_t* coverage_cut, 
 char* output_file_name, ma_hit_t_alloc* reverse_sources, R_to_U* ruIndex, all_ul_t *ul_r_inf)
 {
@@ -33044,7 +33570,7 @@ void init_R_to_U(R_to_U* x, uint64_t len)
 
 void destory_R_to_U(R_to_U* x)
 {
-	free(x->index);
+	if (!graph_ckpt_mapped(x->index)) free(x->index);
 }
 
 void set_R_to_U(R_to_U* x, uint32_t rID, uint32_t uID, uint32_t is_Unitig, uint8_t* flag)
@@ -33053,6 +33579,7 @@ void set_R_to_U(R_to_U* x, uint32_t rID, uint32_t uID, uint32_t is_Unitig, uint8
      
 	if(rID >= x->len)
 	{
+		if(graph_ckpt_mapped(x->index)) x->index = (uint32_t*)graph_ckpt_own(x->index, sizeof(uint32_t)*x->len);
 		x->index = (uint32_t*)realloc(x->index, (rID + 1)*sizeof(uint32_t));
         memset(x->index + x->len, -1, sizeof(uint32_t)*((rID + 1) - x->len));
         x->len = rID + 1;
@@ -33142,7 +33669,7 @@ void renew_graph_init(ma_hit_t_alloc* sources, ma_hit_t_alloc* reverse_sources,
     if(sg != NULL) asg_destroy(sg);
     sg = NULL;
     
-    if(coverage_cut != NULL) free(coverage_cut);
+    if(coverage_cut != NULL && !graph_ckpt_mapped(coverage_cut)) free(coverage_cut);
     coverage_cut = NULL;
 
     memset(ruIndex->index, -1, sizeof(uint32_t)*(ruIndex->len));
@@ -39335,7 +39862,7 @@ long long n_read, uint64_t* readLen, long long mini_overlap_length,
 long long max_hang_length, long long clean_round, long long gap_fuzz,
 float min_ovlp_drop_ratio, float max_ovlp_drop_ratio, char* output_file_name, 
 long long bubble_dist, int read_graph, R_to_U* ruIndex, asg_t **sg_ptr, 
-ma_sub_t **coverage_cut_ptr, uint8_t *cmk, int debug_g)
+ma_sub_t **coverage_cut_ptr, uint8_t *cmk, int debug_g, const uint64_t *ckpt_hs)
 {
     char *o_file = get_outfile_name(output_file_name);
 	ma_sub_t *coverage_cut = *coverage_cut_ptr;
@@ -39359,10 +39886,10 @@ ma_sub_t **coverage_cut_ptr, uint8_t *cmk, int debug_g)
     ///it's hard to say which function is better       
     ///normalize_ma_hit_t_single_side(sources, n_read);
 
-    normalize_ma_hit_t_single_side_advance(sources, n_read, asm_opt.is_ont, cmk);
-    // normalize_ma_hit_t_single_side_advance_mult(sources, n_read, asm_opt.thread_num);
-    normalize_ma_hit_t_single_side_advance(reverse_sources, n_read, 0, cmk);
-    // normalize_ma_hit_t_single_side_advance_mult(reverse_sources, n_read, asm_opt.thread_num);
+    // normalize_ma_hit_t_single_side_advance(sources, n_read, asm_opt.is_ont, cmk);
+    normalize_ma_hit_t_single_side_advance_mult(sources, n_read, asm_opt.is_ont, cmk, asm_opt.thread_num);
+    // normalize_ma_hit_t_single_side_advance(reverse_sources, n_read, 0, cmk);
+    normalize_ma_hit_t_single_side_advance_mult(reverse_sources, n_read, 0, cmk, asm_opt.thread_num);
 
     if (ha_opt_triobin(&asm_opt))
     {
@@ -39445,12 +39972,20 @@ ma_sub_t **coverage_cut_ptr, uint8_t *cmk, int debug_g)
         &sg, mini_overlap_length, max_hang_length, &uopt, clean_round, min_ovlp_drop_ratio, 
         max_ovlp_drop_ratio, asm_opt.max_short_tip, gap_fuzz, min_dp, &b_mask_t, 
         ha_opt_triobin(&asm_opt), asm_opt.ul_clean_round, o_file, "re", te);
-    } else {
+    } else if(debug_g != 2) {///debug_g == 2: everything was restored from the checkpoint written below
         ug_ext_gfa(&uopt, sg, ug_ext_len);
         if(!ha_opt_triobin(&asm_opt)) {
             // output_unitig_graph(sg, coverage_cut, "pre_clean", sources, ruIndex, max_hang_length, mini_overlap_length);
             hic_clean_adv(sg, &uopt);
         }
+        if(ckpt_hs) {
+            char *ckpt_name = (char*)malloc(strlen(output_file_name)+25);
+            sprintf(ckpt_name, "%s.ckpt.bin", output_file_name);
+            if(write_graph_ckpt(ckpt_name, sg, sources, reverse_sources, coverage_cut, ruIndex, ckpt_hs)) {
+                fprintf(stderr, "[M::%s] cleaned graph has been written to %s\n", __func__, ckpt_name);
+            }
+            free(ckpt_name);
+        }
     }
 
     /**
@@ -39697,7 +40232,7 @@ long long bubble_dist, int read_graph, int write)
             
             clean_graph(min_dp, sources, reverse_sources, n_read, readLen, mini_overlap_length, 
             max_hang_length, clean_round, gap_fuzz, min_ovlp_drop_ratio, max_ovlp_drop_ratio, 
-            output_file_name, bubble_dist, read_graph, &ruIndex, &sg, &coverage_cut, cmk, 1);
+            output_file_name, bubble_dist, read_graph, &ruIndex, &sg, &coverage_cut, cmk, 1, NULL);
             asg_destroy(sg);
             free(coverage_cut);
             destory_R_to_U(&ruIndex);
@@ -39724,13 +40259,29 @@ long long bubble_dist, int read_graph, int write)
             if(asm_opt.is_ont) cmk = gen_chemical_arc_rf(asm_opt.thread_num, R_INF.total_reads);
         }
         try_rescue_overlaps(sources, reverse_sources, n_read, 4, asm_opt.is_ont); 
+
+        ///resume from the graph cleaned from the same overlaps, options and Hi-C input
+        uint64_t ckpt_hs[GRAPH_CKPT_HS]; int debug_g = 0;
+        if((asm_opt.flag & HA_F_GRAPH_CKPT) && !asm_opt.ar) {
+            graph_ckpt_hash(sources, reverse_sources, n_read, ckpt_hs);
+            if(asm_opt.load_index_from_disk) {
+                char *ckpt_name = (char*)malloc(strlen(output_file_name)+25);
+                sprintf(ckpt_name, "%s.ckpt.bin", output_file_name);
+                if(load_graph_ckpt(ckpt_name, &sg, sources, reverse_sources, &coverage_cut, &ruIndex, ckpt_hs)) {
+                    fprintf(stderr, "[M::%s] cleaned graph has been loaded from %s\n", __func__, ckpt_name);
+                    debug_g = 2;
+                }
+                free(ckpt_name);
+            }
+        }
         
         clean_graph(min_dp, sources, reverse_sources, n_read, readLen, mini_overlap_length, 
         max_hang_length, clean_round, gap_fuzz, min_ovlp_drop_ratio, max_ovlp_drop_ratio, 
-        output_file_name, bubble_dist, read_graph, &ruIndex, &sg, &coverage_cut, cmk, 0);
+        output_file_name, bubble_dist, read_graph, &ruIndex, &sg, &coverage_cut, cmk, debug_g, 
+        ((asm_opt.flag & HA_F_GRAPH_CKPT) && !asm_opt.ar)?ckpt_hs:NULL);
         
         asg_destroy(sg);
-        free(coverage_cut);
+        if(!graph_ckpt_mapped(coverage_cut)) free(coverage_cut);
     }
 
     destory_R_to_U(&ruIndex); free(cmk);
@@ -235,6 +235,25 @@ typedef struct {
 	ma_utg_t* F_seq;
 } asg_t;
 
+///read-only compressed sparse row snapshot of the live arcs in an asg_t
+///arcs of vertex v are [off[v], off[v+1]); the snapshot never changes, so it can be shared by threads
+#define ASG_CSR_STRONG 1
+#define ASG_CSR_EL 2
+#define ASG_CSR_NO_L_INDEL 4
+typedef struct {
+	uint32_t n_vtx;
+	uint64_t n_arc;
+	uint64_t *off;
+	uint32_t *v; // target vertex
+	uint32_t *len; // asg_arc_len() of the arc
+	uint8_t *flag; // ASG_CSR_*
+} asg_csr_t;
+
+#define asg_csr_n(c, x) ((uint32_t)((c)->off[(x)+1] - (c)->off[(x)]))
+#define asg_csr_v(c, x) (&(c)->v[(c)->off[(x)]])
+#define asg_csr_len(c, x) (&(c)->len[(c)->off[(x)]])
+#define asg_csr_flag(c, x) (&(c)->flag[(c)->off[(x)]])
+
 typedef struct {
 	ma_hit_t_alloc* src;
 	int64_t min_ovlp, max_hang, max_hang_rate, need_srt, gap_fuzz;
@@ -257,6 +276,8 @@ void asg_arc_index(asg_t *g);
 void asg_cleanup(asg_t *g);
 void asg_symm(asg_t *g);
 void print_gfa(asg_t *g);
+asg_csr_t *asg_csr_gen(const asg_t *g);
+void asg_csr_destroy(asg_csr_t *c);
 
 
 typedef struct { size_t n, m; uint64_t *a; } asg64_v;
@@ -274,6 +295,39 @@ typedef struct {
 	uint32_t utg:31, ori:1, start, len;
 } utg_intv_t;
 
+///2-bit packed sequences of all unitigs in a ma_ug_t, using the base layout of ha_compress_base();
+///only used by the Hi-C stage, where u->s is released while the index and the hits are in memory;
+///the UL, purge and scaffolding stages hand u->s to aligners that need plain char* and keep it
+typedef struct {
+	uint32_t n, *len;
+	uint64_t *off; // unitig i is at bases [off[i], off[i]+len[i]) of a; off[i] is a multiple of 4
+	uint8_t *a;
+	uint64_t *N_idx; // N runs of unitig i are N[N_idx[i], N_idx[i+1])
+	uint64_t *N; // start<<32|length
+	uint64_t *ends; // first read vertex<<32|last read vertex of unitig i; identifies i after the graph is renumbered
+	uint64_t *fid; // first read vertex<<32|i, sorted
+} ma_ug_pseq_t;
+
+ma_ug_pseq_t *ma_ug_pseq_gen(ma_ug_t *ug, int free_s);
+void ma_ug_pseq_destroy(ma_ug_pseq_t *p);
+void ma_ug_pseq_retrieve(const ma_ug_pseq_t *p, uint32_t uid, uint8_t strand, uint64_t s, uint64_t l, char *dst);
+void ma_ug_pseq_restore(ma_ug_t *ug, const ma_ug_pseq_t *p);
+
+///the i-th base of unitig uid on the forward strand
+static inline char ma_ug_pseq_at(const ma_ug_pseq_t *p, uint32_t uid, uint64_t i)
+{
+	uint64_t l = p->N_idx[uid], r = p->N_idx[uid+1], m, x = p->off[uid] + i;
+	if (l < r) { ///the last N run starting at or before i
+		while (l < r) {
+			m = (l + r)>>1;
+			if ((p->N[m]>>32) <= i) l = m + 1;
+			else r = m;
+		}
+		if (l > p->N_idx[uid] && i < (p->N[l-1]>>32) + (uint32_t)p->N[l-1]) return 'N';
+	}
+	return "ACGT"[(p->a[x>>2]>>((3-(x&3))<<1))&3];
+}
+
 typedef struct {
 	uint32_t x, s, e;
 } utg_ct_t;
@@ -664,6 +718,12 @@ void init_R_to_U(R_to_U* x, uint64_t len);
 void destory_R_to_U(R_to_U* x);
 void set_R_to_U(R_to_U* x, uint32_t rID, uint32_t uID, uint32_t is_Unitig, uint8_t* flag);
 void get_R_to_U(R_to_U* x, uint32_t rID, uint32_t* uID, uint32_t* is_Unitig);
+int write_graph_ckpt(const char *fn, asg_t *sg, ma_hit_t_alloc *sources, ma_hit_t_alloc *reverse_sources, 
+ma_sub_t *coverage_cut, R_to_U *ruIndex, const uint64_t *hs);
+int load_graph_ckpt(const char *fn, asg_t **sg, ma_hit_t_alloc *sources, ma_hit_t_alloc *reverse_sources, 
+ma_sub_t **coverage_cut, R_to_U *ruIndex, const uint64_t *hs);
+int graph_ckpt_mapped(const void *p);
+void *graph_ckpt_own(const void *p, uint64_t size);
 void transfor_R_to_U(R_to_U* x);
 void debug_utg_graph(ma_ug_t *ug, asg_t* read_g, kvec_asg_arc_t_warp* edge, int require_equal_nv, int test_tangle);
 long long asg_arc_del_simple_circle_untig(ma_hit_t_alloc* sources, ma_sub_t* coverage_cut, asg_t *g, long long circleLen, int is_drop);
@@ -1186,6 +1246,8 @@ void clean_u_trans_t_idx_adv(kv_u_trans_t *ta, ma_ug_t *ug, asg_t *read_g);
 void clean_u_trans_t_idx_filter_adv(kv_u_trans_t *ta, ma_ug_t *ug, asg_t *read_g, double sc_sec_rate, uint64_t uniform_only);
 uint32_t test_dbug(ma_ug_t* ug, FILE* fp);
 void write_dbug(ma_ug_t* ug, FILE* fp);
+uint64_t ma_ug_hash(ma_ug_t* ug);
+uint64_t ma_hit_hash(ma_hit_t_alloc *x, uint64_t n_read);
 int asg_arc_identify_simple_bubbles_multi(asg_t *g, bub_label_t* x, int check_cross);
 uint8_t get_tip_trio_infor(asg_t *sg, uint32_t begNode);
 int asg_topocut_aux(asg_t *g, uint32_t v, int max_ext);
@@ -2,6 +2,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include "Process_Read.h"
 #include "htab.h"
 #include "Correct.h"
@@ -49,8 +51,8 @@ void destory_All_reads(All_reads* r)
 	for (i = 0; i < r->total_reads; i++) {
 		if (r->N_site[i]) free(r->N_site[i]);
 		if (r->read_sperate[i]) free(r->read_sperate[i]);
-		if (r->paf && r->paf[i].buffer) free(r->paf[i].buffer);
-		if (r->reverse_paf && r->reverse_paf[i].buffer) free(r->reverse_paf[i].buffer);
+		if (r->paf && r->paf[i].buffer) destory_ma_hit_t_alloc(&(r->paf[i]));
+		if (r->reverse_paf && r->reverse_paf[i].buffer) destory_ma_hit_t_alloc(&(r->reverse_paf[i]));
 		if(r->rsc && r->rsc[i]) free(r->rsc[i]);
 		///if (r->pb_regions) kv_destroy(r->pb_regions[i].a);
 	}
@@ -61,7 +63,7 @@ void destory_All_reads(All_reads* r)
 	free(r->name);
 	free(r->name_index);
 	free(r->read_length);
-	free(r->trio_flag);
+	if (!graph_ckpt_mapped(r->trio_flag)) free(r->trio_flag);
 	free(r->rsc);
 	///if (r->pb_regions) free(r->pb_regions);
 }
@@ -403,7 +405,7 @@ int destory_read_bin(All_reads* r)
 	free(r->read_sperate);
 	free(r->name);
 	free(r->name_index);
-	free(r->trio_flag);
+	if (!graph_ckpt_mapped(r->trio_flag)) free(r->trio_flag);
 	free(r->cigars);
 	free(r->second_round_cigar);
 	return 1;
@@ -1085,9 +1087,11 @@ void init_all_ul_t(all_ul_t *x, All_reads *hR) {
 void destory_all_ul_t(all_ul_t *x) {
 	uint64_t i;
 	for (i = 0; i < x->n; i++) {
-		free(x->a[i].N_site.a); free(x->a[i].r_base.a); free(x->a[i].bb.a);
+		ul_vec_free(&(x->a[i]));
 	}
 	free(x->a);
+	for (i = 0; i < x->mm.n; i++) munmap(x->mm.a[i].a, x->mm.a[i].n);
+	free(x->mm.a);
 
 	for (i = 0; i < x->nid.n; i++) free(x->nid.a[i].a);
 	free(x->nid.a);
@@ -1206,6 +1210,7 @@ void append_ul_t_compress_ovlp(all_ul_t *x, uint64_t *rid, char* id, int64_t id_
 		
 
 		p->bb.n = p->N_site.n = p->r_base.n = 0;
+		ul_bb_own(p); ul_rb_own(p);
 		p->rlen = str_l; 
 		
 		if(o == NULL || on == 0) on = 0;
@@ -1331,6 +1336,7 @@ void append_ul_t_back(all_ul_t *x, uint64_t *rid, char* id, int64_t id_l, char*
 		// if((*rid) == 23) fprintf(stderr, "#rid->%lu, on->%ld\n", *rid, on);
 
 		p->bb.n = p->N_site.n = p->r_base.n = 0; p->dd = 0;
+		ul_bb_own(p); ul_rb_own(p);
 		p->rlen = str_l; 
 		
 		if(o == NULL || on == 0) on = 0;
@@ -1496,6 +1502,7 @@ void append_ul_t(all_ul_t *x, uint64_t *rid, char* id, int64_t id_l, char* str,
 		// if((*rid) == 23) fprintf(stderr, "#rid->%lu, on->%ld\n", *rid, on);
 
 		p->bb.n = p->N_site.n = p->r_base.n = 0; p->dd = 0;
+		ul_bb_own(p); ul_rb_own(p);
 		p->rlen = str_l; 
 		// fprintf(stderr, "str_l->%ld, str->%u\n", str_l, str?1:0);
 		
@@ -1723,6 +1730,58 @@ void retrieve_ul_t(UC_Read* i_r, char *i_s, all_ul_t *ref, uint64_t ID, uint8_t
 	}
 }
 
+///write the resident alignment blocks and packed bases of all UL reads to <prefix>.ul.spill.bin and page them back through mmap();
+///the mapping is private, so blocks that are updated in place become resident while untouched ones stay on disk;
+///vectors taken back by ul_bb_own()/ul_rb_own() are resident again and are paged by the next call
+void spill_ul_t(all_ul_t *x, const char *prefix)
+{
+	uint64_t k, bn, rn, off; ul_vec_t *p; uint8_t *mm; ul_pg_t pg;
+	char *fn; FILE *fp; int fd, err;
+	for (k = bn = rn = 0; k < x->n; k++) {
+		if(!(x->a[k].pg&UL_PG_BB)) bn += x->a[k].bb.n;
+		if(!(x->a[k].pg&UL_PG_RB)) rn += x->a[k].r_base.n;
+	}
+	if(!asm_opt.ul_spill_mem || bn*sizeof(uc_block_t) + rn < asm_opt.ul_spill_mem) return;
+
+	MALLOC(fn, strlen(prefix)+50);
+	sprintf(fn, "%s.ul.spill.bin", prefix);
+	fp = fopen(fn, "w");
+	if(!fp) {
+		free(fn); return;
+	}
+	for (k = 0; k < x->n; k++) {///blocks first to keep them aligned
+		p = &(x->a[k]);
+		if(!(p->pg&UL_PG_BB) && p->bb.n) fwrite(p->bb.a, sizeof((*(p->bb.a))), p->bb.n, fp);
+	}
+	for (k = 0; k < x->n; k++) {
+		p = &(x->a[k]);
+		if(!(p->pg&UL_PG_RB) && p->r_base.n) fwrite(p->r_base.a, sizeof((*(p->r_base.a))), p->r_base.n, fp);
+	}
+	err = ferror(fp); err |= fclose(fp);
+	fd = err? -1 : open(fn, O_RDONLY); 
+	unlink(fn); free(fn);///the mapping keeps the file alive; nothing is left on disk
+	if(fd < 0) return;
+	off = bn*sizeof(uc_block_t) + rn;
+	mm = (uint8_t*)mmap(NULL, off, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0); close(fd);
+	if(mm == MAP_FAILED) return;
+	pg.a = mm; pg.n = off; kv_push(ul_pg_t, x->mm, pg);
+
+	for (k = off = 0; k < x->n; k++) {
+		p = &(x->a[k]);
+		if(p->pg&UL_PG_BB) continue;
+		free(p->bb.a); p->bb.a = (p->bb.n? (uc_block_t*)(mm + off) : NULL); 
+		p->bb.m = 0; p->pg |= UL_PG_BB; off += p->bb.n*sizeof(uc_block_t);
+	}
+	for (k = 0; k < x->n; k++) {
+		p = &(x->a[k]);
+		if(p->pg&UL_PG_RB) continue;
+		free(p->r_base.a); p->r_base.a = (p->r_base.n? mm + off : NULL); 
+		p->r_base.m = 0; p->pg |= UL_PG_RB; off += p->r_base.n;
+	}
+	for (k = off = 0; k < x->mm.n; k++) off += x->mm.a[k].n;
+	fprintf(stderr, "[M::%s] %.2f GB of UL blocks and bases are paged from disk\n", __func__, (double)off/1073741824.0);
+}
+
 
 void retrieve_u_seq(UC_Read* i_r, char* i_s, ma_utg_t *u, uint8_t strand, int64_t s, int64_t l, void *km)
 {
@@ -2225,7 +2284,7 @@ void destroy_scaf_res_t(scaf_res_t *p)
 	if(p) {
 		uint32_t k;
 		for (k = 0; k < p->m; k++) {
-			free(p->a[k].N_site.a); free(p->a[k].r_base.a); free(p->a[k].bb.a);	
+			ul_vec_free(&(p->a[k]));
 		}
 		free(p->a);
 		free(p);
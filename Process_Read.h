@@ -111,6 +111,30 @@ typedef struct
 #define CHAIN_UNMATCH 0.334
 
 #define NEC 1
+///bits of ul_vec_t::pg; such a vector is paged from disk by spill_ul_t() and is neither grown nor freed in place
+#define UL_PG_BB 1
+#define UL_PG_RB 2
+///make the vector v of ul_vec_t *p resident before it is grown
+#define ul_kv_own(type, p, v, bit) do { \
+    if((p)->pg & (bit)) { \
+        type *_a = NULL; \
+        assert((p)->v.m == 0); \
+        if((p)->v.n) { \
+            MALLOC(_a, (p)->v.n); memcpy(_a, (p)->v.a, sizeof(type)*(p)->v.n); \
+        } \
+        (p)->v.a = _a; (p)->v.m = (p)->v.n; (p)->pg &= ~(bit); \
+    } \
+} while(0)
+#define ul_bb_own(p) ul_kv_own(uc_block_t, p, bb, UL_PG_BB)
+#define ul_rb_own(p) ul_kv_own(uint8_t, p, r_base, UL_PG_RB)
+///free what ul_vec_t *p owns
+#define ul_vec_free(p) do { \
+    free((p)->N_site.a); \
+    if((p)->pg & UL_PG_RB) assert((p)->r_base.m == 0); \
+    else free((p)->r_base.a); \
+    if((p)->pg & UL_PG_BB) assert((p)->bb.m == 0); \
+    else free((p)->bb.a); \
+} while(0)
 
 typedef struct
 {
@@ -193,6 +217,7 @@ typedef struct
     N_t N_site;
 
     uint8_t dd;
+    uint8_t pg; ///UL_PG_BB and UL_PG_RB
 } ul_vec_t;
 
 typedef struct{
@@ -200,6 +225,12 @@ typedef struct{
     kvec_t(uint64_t) occ;
 } ul_vec_rid_t;
 
+typedef struct
+{
+    uint8_t *a;
+    uint64_t n;
+} ul_pg_t;
+
 typedef struct
 {
     kvec_t(nid_t) nid;
@@ -207,6 +238,7 @@ typedef struct
     ul_vec_t *a;
     size_t n, m;
     All_reads *hR;
+    kvec_t(ul_pg_t) mm; ///one mapping per spill_ul_t() call that paged blocks and bases from disk
     // idx_emask_t *mm;
     // uint32_t mm;
 } all_ul_t;
@@ -247,12 +279,14 @@ void init_all_ul_t(all_ul_t *x, All_reads *hR);
 void destory_all_ul_t(all_ul_t *x);
 void append_ul_t(all_ul_t *x, uint64_t *rid, char* id, int64_t id_l, char* str, int64_t str_l, ul_ov_t *o, int64_t on, float p_chain_rate, const ug_opt_t *uopt, uint32_t save_bases);
 void retrieve_ul_t(UC_Read* i_r, char *i_s, all_ul_t *ref, uint64_t ID, uint8_t strand, int64_t s, int64_t l);
+void spill_ul_t(all_ul_t *x, const char *prefix);
 void retrieve_u_seq(UC_Read* i_r, char* i_s, ma_utg_t *u, uint8_t strand, int64_t s, int64_t l, void *km);
 void debug_retrieve_rc_sub(const ug_opt_t *uopt, all_ul_t *ref, const All_reads *R_INF, ul_idx_t *ul, uint32_t n_step);
 uint32_t retrieve_u_cov(const ul_idx_t *ul, uint64_t id, uint8_t strand, uint64_t pos, uint8_t dir, int64_t *pi);
 uint64_t retrieve_u_cov_region(const ul_idx_t *ul, uint64_t id, uint8_t strand, uint64_t s, uint64_t e, int64_t *pi);
 uint64_t retrieve_r_cov_region(const ul_idx_t *ul, uint64_t id, uint8_t strand, uint64_t s, uint64_t e, int64_t *pi);
 void append_ul_t_back(all_ul_t *x, uint64_t *rid, char* id, int64_t id_l, char* str, int64_t str_l, ul_ov_t *o, int64_t on, float p_chain_rate);
+void ha_encode_base(uint8_t* dest, char* src, uint64_t src_l, N_t *nn, uint64_t nn_offset);
 void write_compress_base_disk(FILE *fp, uint64_t ul_rid, char *str, uint32_t len, ul_vec_t *buf);
 int64_t load_compress_base_disk(FILE *fp, uint64_t *ul_rid, char *dest, uint32_t *len, ul_vec_t *buf);
 scaf_res_t *init_scaf_res_t(uint32_t n);
@@ -7310,7 +7310,8 @@ void push_integer_seq_exact(ul_vec_t *res, ma_ug_t *ug, uint64_t *seq, uint64_t
     if(seq_n <= 0) return;
     uint64_t k, v, ql, ul; uc_block_t *x;
     // fprintf(stderr, "[M::%s::] old_len::%u, new_len::%u\n", __func__, res->rlen, (uint32_t)off[seq_n-1]);
-    res->rlen = (uint32_t)off[seq_n-1]; res->bb.n = 0; kv_resize(uc_block_t, res->bb, seq_n);
+    res->rlen = (uint32_t)off[seq_n-1]; res->bb.n = 0; 
+    ul_bb_own(res); kv_resize(uc_block_t, res->bb, seq_n);
     for (k = 0; k < seq_n; k++) {
         v = (uint32_t)seq[k];
         kv_pushp(uc_block_t, res->bb, &x);
@@ -14819,10 +14820,12 @@ int64_t reload_uovl(all_ul_t *x, char* file_name)
         fread(&p->rlen, sizeof(p->rlen), 1, fp);
 
         fread(&p->r_base.n, sizeof(p->r_base.n), 1, fp); 
+        if(p->pg&UL_PG_RB) p->r_base.a = NULL, p->r_base.m = 0, p->pg &= ~UL_PG_RB;///paged; overwritten anyway
         if(p->r_base.n > p->r_base.m) kv_resize(uint8_t, p->r_base, p->r_base.n);        
         fread(p->r_base.a, sizeof((*(p->r_base.a))), p->r_base.n, fp);
 
         fread(&p->bb.n, sizeof(p->bb.n), 1, fp); 
+        if(p->pg&UL_PG_BB) p->bb.a = NULL, p->bb.m = 0, p->pg &= ~UL_PG_BB;
         if(p->bb.n > p->bb.m) kv_resize(uc_block_t, p->bb, p->bb.n);
         fread(p->bb.a, sizeof((*(p->bb.a))), p->bb.n, fp);
 
@@ -17674,8 +17677,8 @@ ul_renew_t *ropt, const char *bin_file, uint64_t free_uld, uint64_t is_bridg, ui
     } else {
         for (i = 0; i < bn; i++) UL_INF.a[i].rlen = bl[i];
         for (i = bn; i < UL_INF.n; i++) {
-            free(UL_INF.a[i].N_site.a); free(UL_INF.a[i].r_base.a); 
-            free(UL_INF.a[i].bb.a); memset(&(UL_INF.a[i]), 0, sizeof(UL_INF.a[i]));
+            ul_vec_free(&(UL_INF.a[i]));
+            memset(&(UL_INF.a[i]), 0, sizeof(UL_INF.a[i]));
         }
         UL_INF.n = bn;
 
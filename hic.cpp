@@ -1,6 +1,10 @@
 #define __STDC_LIMIT_MACROS
 #include "float.h"
 #include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include "hic.h"
 #include "htab.h"
 #include "assert.h"
@@ -44,7 +48,11 @@ KRADIX_SORT_INIT(u_trans_m, u_trans_t, u_trans_m_key, 8)
 KRADIX_SORT_INIT(u_trans_occ, u_trans_t, u_trans_occ_key, member_size(u_trans_t, occ))
 
 #define is_hom_hit(a) ((a).id == (uint64_t)-1)
-#define HC_PT_MA 65
+#define HC_PT_MA 66
+#define HC_LK_MA 67
+#define HC_LINK_MA 68
+#define HC_LK_BLK 65536 ///hits per encoded block in *.hic.lk.bin
+#define HC_SEG_LEN 1048576 ///unitigs are indexed in segments of HC_SEG_LEN bases
 
 typedef struct {
     kv_gg_status sg;
@@ -71,6 +79,9 @@ typedef struct{
     kdq_t(uint64_t) *q;
     kvec_t(uint32_t) parent;
     kvec_t(double) p_weight;
+    kvec_t(uint32_t) level;///BFS level of each node in the residual graph
+    kvec_t(uint32_t) iter;///current arc of each node in the level graph
+    kvec_t(asg32_v) rIdx;///rIdx.a[v].a[i]: index of the reverse edge of rGraph.a[v].a[i]
     const uint64_t* enzymes;
     uint64_t uID_mode, uID_shift, n, src, dest, n_e, c_e;
     int p_mer, a_mer, b_mer;
@@ -158,8 +169,14 @@ typedef struct {
     uint64_t up_bound, low_bound;
     hc_pt1_t* idx_buf;
     long double a, b, frac, max_d;
+    ma_ug_pseq_t *ps; ///packed unitig sequences, used where ug->u.a[].s has been released
+    uint64_t *pa, n_pa;///positions of all buckets; idx_buf[].a points into it
+    uint8_t *mm; uint64_t mm_len;///mapped index file, if loaded by load_hc_pt_index()
+    uint64_t *flt, flt_bits;///blocked Bloom filter of the k-mers that can place a Hi-C mate
 } ha_ug_index;
 
+#define hc_ubase(idx, uid, i) ((idx)->ug->u.a[(uid)].s? (idx)->ug->u.a[(uid)].s[(i)] : ma_ug_pseq_at((idx)->ps, (uid), (i)))
+
 typedef struct { // data structure for each step in kt_pipeline()
     uint64_t key, pos;
 } ch_buf_t;
@@ -168,17 +185,14 @@ typedef struct {
 	kvec_t(uint64_t) a;
 } kvec_cnt;
 
-typedef struct {
-	kvec_t(ch_buf_t) a;
-} kvec_pos;
-
-typedef struct { // global data structure for kt_pipeline()
+typedef struct { // global data structure for kt_for()
 	int is_cnt;
     uint64_t buf_bytes;
 	ha_ug_index *h;
-    kvec_cnt* cnt;
-	kvec_pos* buf;
+    kvec_cnt* cnt;///n_thread*tot k-mer buffers, partitioned by thread and bucket
     uint64_t n_thread;
+    uint64_t *seg, n_seg;///uID<<32|start of each segment
+    kvec_t(char) *ub;///per-thread unitig sequence
 } pldat_t;
 
 typedef struct {
@@ -205,6 +219,8 @@ KRADIX_SORT_INIT(pe_hit_an2, pe_hit, pe_hit_an2_key, member_size(pe_hit, e))
 KRADIX_SORT_INIT(pe_hit_idx_an1, pe_hit, pe_hit_an1_idx_key, member_size(pe_hit, s))
 #define pe_hit_an2_idx_key(x) ((x).e<<1)
 KRADIX_SORT_INIT(pe_hit_idx_an2, pe_hit, pe_hit_an2_idx_key, member_size(pe_hit, e))
+KRADIX_SORT_MT_INIT(pe_hit_an1, pe_hit, pe_hit_an1_key, member_size(pe_hit, s))
+KRADIX_SORT_MT_INIT(pe_hit_idx_an1, pe_hit, pe_hit_an1_idx_key, member_size(pe_hit, s))
 
 #define generic_key(x) (x)
 KRADIX_SORT_INIT(hc64, uint64_t, generic_key, 8)
@@ -227,6 +243,13 @@ KRADIX_SORT_INIT(pe_occ_t, pe_hit_hap, pe_occ_key_t, 8)
 #define asg_arc_key(a) ((a).ul)
 KRADIX_SORT_INIT(asg_e, asg_arc_t, asg_arc_key, 8)
 
+typedef struct {
+	kseq_t *ks;
+    uint64_t n, n_max; ///n_max: number of records to read
+    kvec_t(uint64_t) off; ///off.a[i]: start of the i-th record in s
+    kvec_t(char) s;
+} hc_mate_buf_t;
+
 typedef struct { // global data structure for kt_pipeline()
 	const ha_ug_index* idx;
 	kseq_t *ks1, *ks2;
@@ -237,6 +260,11 @@ typedef struct { // global data structure for kt_pipeline()
     kvec_pe_hit hits;
     ///kvec_pe_hit_hap hits;
     trans_chain* t_ch;
+    ///R1 and R2 are decompressed concurrently once the number of pairs per chunk is known
+    uint64_t n_io, n_pair_b, is_eof;
+    hc_mate_buf_t mb[2];
+    ///sorted and deduplicated runs of hits spilled to disk
+    uint64_t spill_max, n_spill;
 } sldat_t;
 
 typedef struct {
@@ -250,7 +278,8 @@ typedef struct {
 
 typedef struct { // data structure for each step in kt_pipeline()
     const ha_ug_index* idx;
-	int n, m, sum_len;
+	int n, m;
+	int64_t sum_len;
 	uint64_t *len, id;
 	char **seq;
 	ch_buf_t *buf;
@@ -262,8 +291,6 @@ typedef struct { // data structure for each step in kt_pipeline()
 
 #define generic_key(x) (x)
 KRADIX_SORT_INIT(b64, uint64_t, generic_key, 8)
-#define ch_buf_t_key(a) ((a).key)
-KRADIX_SORT_INIT(ch_buf, ch_buf_t, ch_buf_t_key, member_size(ch_buf_t, key))
 #define hc_pos_key(x) ((x)<<1)
 KRADIX_SORT_INIT(hc_pos, uint64_t, hc_pos_key, 8)
 #define hc_s_hit_an1_key(a) ((a).ref)
@@ -336,14 +363,20 @@ uint64_t low_occ, uint64_t thread_num)
     n = n << 3;
     p->h = idx;
     p->buf_bytes = n>>7;
-    CALLOC(p->cnt, idx->tot);
-    CALLOC(p->buf, idx->tot);
-    for (i = 0; i < idx->tot; i++)
+    p->n_thread = thread_num>0?thread_num:1;
+    CALLOC(p->cnt, idx->tot*p->n_thread);
+    CALLOC(p->ub, p->n_thread);
+    for (i = n = 0; i < ug->u.n; i++)
     {
-        kv_init(p->cnt[i].a);
-        kv_init(p->buf[i].a);
+        if(ug->u.a[i].m == 0) continue;
+        n += (ug->u.a[i].len + HC_SEG_LEN - 1)/HC_SEG_LEN;
+    }
+    MALLOC(p->seg, n); p->n_seg = 0;
+    for (i = 0; i < ug->u.n; i++)
+    {
+        if(ug->u.a[i].m == 0) continue;
+        for (n = 0; n < ug->u.a[i].len; n += HC_SEG_LEN) p->seg[p->n_seg++] = (i<<32)|n;
     }
-    p->n_thread = thread_num;
 }
 
 inline uint64_t get_k_direction(uint64_t x[4])
@@ -396,6 +429,105 @@ inline uint64_t get_hc_pt1_count(ha_ug_index* index, uint64_t key, uint64_t** po
     return h->n - beg;
 }
 
+///a k-mer places a mate only if it occurs at most hap_cnt times, each time in a different unitig
+inline uint64_t hc_kmer_placeable(const ha_ug_index* idx, uint64_t cnt, uint64_t* pos_list)
+{
+    uint64_t j, k, uID;
+    if(cnt > idx->hap_cnt || cnt <= 0) return 0;
+    for (j = 0; j + 1 < cnt; j++)
+    {
+        uID = (pos_list[j] << 1) >> (64 - idx->uID_bits);
+        for (k = j + 1; k < cnt; k++)
+        {
+            if(uID == ((pos_list[k] << 1) >> (64 - idx->uID_bits))) return 0;
+        }
+    }
+    return 1;
+}
+
+#define HC_FLT_KEY_BITS 8 ///filter bits per placeable k-mer
+
+///two bits in one 512-bit block; no false negatives
+inline uint64_t hc_flt_test(const ha_ug_index* idx, uint64_t hash)
+{
+    if(!idx->flt) return 1;
+    uint64_t m = yak_hash64_64(hash), *b = idx->flt + ((((m>>18)&((1ULL<<idx->flt_bits)-1)))<<3);
+    return ((b[(m>>6)&7]>>(m&63))&1) && ((b[(m>>15)&7]>>((m>>9)&63))&1);
+}
+
+typedef struct { // data structure for each step in kt_for()
+    ha_ug_index* idx;
+    uint64_t *cnt;
+    int is_cnt;
+} hc_flt_aux_t;
+
+static void worker_for_flt(void *data, long i, int tid) // callback for kt_for()
+{
+    hc_flt_aux_t *a = (hc_flt_aux_t*)data;
+    ha_ug_index* idx = a->idx;
+    hc_pt1_t *h = &(idx->idx_buf[i]);
+    uint64_t hash, cnt, m, *b, *pos_list = NULL;
+    khint_t k;
+    for (k = 0, a->cnt[i] = 0; k != kh_end(h->h); ++k) {
+        if (!kh_exist(h->h, k)) continue;
+        ///the low bits of a key keep its count instead of the bucket id
+        hash = (kh_key(h->h, k)&HIC_KEY_MODE)|((uint64_t)i);
+        cnt = get_hc_pt1_count(idx, hash, &pos_list);
+        if(!hc_kmer_placeable(idx, cnt, pos_list)) continue;
+        a->cnt[i]++;
+        if(a->is_cnt) continue;
+        m = yak_hash64_64(hash); b = idx->flt + ((((m>>18)&((1ULL<<idx->flt_bits)-1)))<<3);
+        __sync_fetch_and_or(&(b[(m>>6)&7]), 1ULL<<(m&63));
+        __sync_fetch_and_or(&(b[(m>>15)&7]), 1ULL<<((m>>9)&63));
+    }
+}
+
+void hc_flt_gen(ha_ug_index* idx, uint64_t n_thread)
+{
+    double index_time = yak_realtime();
+    hc_flt_aux_t a; uint64_t i, n;
+    a.idx = idx; a.is_cnt = 1; CALLOC(a.cnt, idx->tot);
+    free(idx->flt); idx->flt = NULL; 
+    kt_for(n_thread, worker_for_flt, &a, idx->tot);
+    for (i = n = 0; i < idx->tot; i++) n += a.cnt[i];
+    for (idx->flt_bits = 0; (512ULL<<idx->flt_bits) < n * HC_FLT_KEY_BITS; idx->flt_bits++);
+    CALLOC(idx->flt, 8ULL<<idx->flt_bits);
+    a.is_cnt = 0;
+    kt_for(n_thread, worker_for_flt, &a, idx->tot);
+    free(a.cnt);
+    fprintf(stderr, "[M::%s::%.3f] ==> %lu placeable k-mers, %lu MB filter\n", __func__, 
+                yak_realtime()-index_time, (unsigned long)n, (unsigned long)((64ULL<<idx->flt_bits)>>20));
+}
+
+void hc_flt_destroy(ha_ug_index* idx)
+{
+    free(idx->flt); idx->flt = NULL; idx->flt_bits = 0;
+}
+
+///0 if no k-mer of r passes the filter, in which case get_alignment() places nothing
+inline uint64_t hc_mate_flt(const char *r, uint64_t len, const ha_ug_index* idx)
+{
+    uint64_t i, l, skip, hash, k_mer = idx->k;
+    uint64_t x[4], mask = (1ULL<<k_mer) - 1, shift = k_mer - 1;
+    if(!idx->flt) return 1;
+    for (i = l = 0, x[0] = x[1] = x[2] = x[3] = 0; i < len; ++i) {
+        int c = seq_nt4_table[(uint8_t)r[i]];
+        if (c < 4) {
+            x[0] = (x[0] << 1 | (c&1))  & mask;
+            x[1] = (x[1] << 1 | (c>>1)) & mask;
+            x[2] = x[2] >> 1 | (uint64_t)(1 - (c&1))  << shift;
+            x[3] = x[3] >> 1 | (uint64_t)(1 - (c>>1)) << shift;
+            if (++l >= k_mer)
+            {
+                hash = hc_hash_long(x, &skip, k_mer);
+                if(skip == (uint64_t)-1) continue;
+                if(hc_flt_test(idx, hash)) return 1;
+            }
+        } else l = 0, x[0] = x[1] = x[2] = x[3] = 0;
+    }
+    return 0;
+}
+
 void test_hc_pt1(char* seq, uint64_t len, uint64_t uID, ha_ug_index* idx)
 {
     uint64_t i, l, k, pos, *pos_list = NULL, cnt;
@@ -491,10 +623,20 @@ void hc_pt_t_gen_single(hc_pt1_t* pt, uint64_t* up_bound, uint64_t* low_bound)
             pt->end = k;
         }
     }
-    CALLOC(pt->a, pt->n);
+    ///positions are allocated in ha_ug_index::pa by hc_pt_t_gen()
 }
 
+typedef struct {
+    uint64_t magic, uID_bits, uID_mode, pos_bits, pos_mode, rev_mode, k, pre, tot, tot_pos;
+    uint64_t n_pa, pa_off, dbug_off;
+} hc_pt_hdr_t;
+
+typedef struct {
+    uint64_t n, end, bits, count, used_off, keys_off;
+} hc_pt_bkt_t;
 
+///layout of the index file: hc_pt_hdr_t, tot*hc_pt_bkt_t, positions, then the hash table 
+///of each bucket, all 8-byte aligned so that the file can be mapped as it is
 int write_hc_pt_index(ha_ug_index* idx, char* file_name)
 {
     char* gfa_name = (char*)malloc(strlen(file_name)+25);
@@ -504,98 +646,131 @@ int write_hc_pt_index(ha_ug_index* idx, char* file_name)
         free(gfa_name);
         return 0;
     }
-    uint64_t i = HC_PT_MA;
+    uint64_t i, off, n_b, zero = 0;
+    hc_pt_hdr_t hd; hc_pt_bkt_t *bk = NULL; CALLOC(bk, idx->tot);
+    memset(&hd, 0, sizeof(hd));
+    hd.magic = HC_PT_MA; hd.uID_bits = idx->uID_bits; hd.uID_mode = idx->uID_mode; 
+    hd.pos_bits = idx->pos_bits; hd.pos_mode = idx->pos_mode; hd.rev_mode = idx->rev_mode;
+    hd.k = idx->k; hd.pre = idx->pre; hd.tot = idx->tot; hd.tot_pos = idx->tot_pos;
 
-    fwrite(&i, sizeof(i), 1, fp);
-    fwrite(&idx->uID_bits, sizeof(idx->uID_bits), 1, fp);
-    fwrite(&idx->uID_mode, sizeof(idx->uID_mode), 1, fp);
-    fwrite(&idx->pos_bits, sizeof(idx->pos_bits), 1, fp);
-    fwrite(&idx->pos_mode, sizeof(idx->pos_mode), 1, fp);
-    fwrite(&idx->rev_mode, sizeof(idx->rev_mode), 1, fp);
-    fwrite(&idx->k, sizeof(idx->k), 1, fp);
-    fwrite(&idx->pre, sizeof(idx->pre), 1, fp);
-    fwrite(&idx->tot, sizeof(idx->tot), 1, fp);
-    fwrite(&idx->tot_pos, sizeof(idx->tot_pos), 1, fp);
+    off = sizeof(hd) + sizeof(*bk)*idx->tot;
+    for (i = hd.n_pa = 0; i < idx->tot; i++) hd.n_pa += idx->idx_buf[i].n;
+    hd.pa_off = off; off += hd.n_pa*sizeof(uint64_t);
+    for (i = 0; i < idx->tot; i++)
+    {
+        bk[i].n = idx->idx_buf[i].n; bk[i].end = idx->idx_buf[i].end;
+        bk[i].bits = idx->idx_buf[i].h->bits; bk[i].count = idx->idx_buf[i].h->count;
+        n_b = idx->idx_buf[i].h->keys? 1U<<idx->idx_buf[i].h->bits : 0U;
+        bk[i].used_off = bk[i].keys_off = 0;
+        if(idx->idx_buf[i].h->used) 
+        {
+            bk[i].used_off = off; off += ((__kh_fsize(n_b)*sizeof(khint32_t) + 7)>>3)<<3;
+        }
+        if(idx->idx_buf[i].h->keys)
+        {
+            bk[i].keys_off = off; off += n_b*sizeof(*(idx->idx_buf[i].h->keys));
+        }
+    }
+    hd.dbug_off = off;
 
+    fwrite(&hd, sizeof(hd), 1, fp);
+    fwrite(bk, sizeof(*bk), idx->tot, fp);
+    for (i = 0; i < idx->tot; i++) fwrite(idx->idx_buf[i].a, sizeof(uint64_t), idx->idx_buf[i].n, fp);
     for (i = 0; i < idx->tot; i++)
     {
-        fwrite(&idx->idx_buf[i].n, sizeof(idx->idx_buf[i].n), 1, fp);
-        fwrite(&idx->idx_buf[i].end, sizeof(idx->idx_buf[i].end), 1, fp);
-        fwrite(idx->idx_buf[i].a, sizeof(uint64_t), idx->idx_buf[i].n, fp);
-        hc_pt_save(idx->idx_buf[i].h, fp);
+        n_b = idx->idx_buf[i].h->keys? 1U<<idx->idx_buf[i].h->bits : 0U;
+        if(idx->idx_buf[i].h->used)
+        {
+            fwrite(idx->idx_buf[i].h->used, sizeof(khint32_t), __kh_fsize(n_b), fp);
+            fwrite(&zero, 1, (((__kh_fsize(n_b)*sizeof(khint32_t) + 7)>>3)<<3) - __kh_fsize(n_b)*sizeof(khint32_t), fp);
+        }
+        if(idx->idx_buf[i].h->keys) fwrite(idx->idx_buf[i].h->keys, sizeof(*(idx->idx_buf[i].h->keys)), n_b, fp);
     }
 
     write_dbug(idx->ug, fp);
 
     fprintf(stderr, "[M::%s] Index has been written.\n", __func__);
-    free(gfa_name);
+    free(gfa_name); free(bk);
     fclose(fp);
     return 1;
 }
 
 void destory_hc_pt_index(ha_ug_index* idx);
+///the index is mapped, not read; positions and hash tables point into the mapping
 int load_hc_pt_index(ha_ug_index** r_idx, ma_ug_t *ug, char* file_name)
 {
-    uint64_t flag = 0;
-    // double index_time = yak_realtime();
     char* gfa_name = (char*)malloc(strlen(file_name)+25);
     sprintf(gfa_name, "%s.hic.tlb.bin", file_name);
-    FILE* fp = fopen(gfa_name, "r");
-    if (!fp) {
-        free(gfa_name);
-        return 0;
-    }
-    ha_ug_index* idx = NULL; CALLOC(idx, 1);
-    uint64_t i;
-
-    flag += fread(&i, sizeof(i), 1, fp);
-    if(i != HC_PT_MA)
-    {
+    int fd = open(gfa_name, O_RDONLY);
+    struct stat st;
+    (*r_idx) = NULL;
+    if (fd < 0) {
         free(gfa_name);
-        destory_hc_pt_index(idx);
-        free(idx);
-        (*r_idx) = NULL;
-        fclose(fp);
-        fprintf(stderr, "[M::%s::] ==> Renew Hi-C index\n", __func__);
         return 0;
     }
-    flag += fread(&idx->uID_bits, sizeof(idx->uID_bits), 1, fp);
-    flag += fread(&idx->uID_mode, sizeof(idx->uID_mode), 1, fp);
-    flag += fread(&idx->pos_bits, sizeof(idx->pos_bits), 1, fp);
-    flag += fread(&idx->pos_mode, sizeof(idx->pos_mode), 1, fp);
-    flag += fread(&idx->rev_mode, sizeof(idx->rev_mode), 1, fp);
-    flag += fread(&idx->k, sizeof(idx->k), 1, fp);
-    flag += fread(&idx->pre, sizeof(idx->pre), 1, fp);
-    flag += fread(&idx->tot, sizeof(idx->tot), 1, fp);
-    flag += fread(&idx->tot_pos, sizeof(idx->tot_pos), 1, fp);
-    MALLOC(idx->idx_buf, idx->tot);
-
-    for (i = 0; i < idx->tot; i++)
+    hc_pt_hdr_t *hd = NULL; hc_pt_bkt_t *bk = NULL;
+    ha_ug_index* idx = NULL; 
+    uint64_t i, n_b, n_pa;
+    uint8_t *mm = NULL;
+    FILE* fp = NULL;
+
+    if(fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(*hd)) goto renew;
+    mm = (uint8_t*)mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if(mm == MAP_FAILED) 
+    {
+        mm = NULL; goto renew;
+    }
+    hd = (hc_pt_hdr_t*)mm;
+    if(hd->magic != HC_PT_MA || hd->dbug_off > (uint64_t)st.st_size || 
+                    sizeof(*hd) + sizeof(*bk)*hd->tot > hd->pa_off || 
+                    hd->pa_off + hd->n_pa*sizeof(uint64_t) > hd->dbug_off) goto renew;
+    bk = (hc_pt_bkt_t*)(mm + sizeof(*hd));
+
+    CALLOC(idx, 1);
+    idx->uID_bits = hd->uID_bits; idx->uID_mode = hd->uID_mode;
+    idx->pos_bits = hd->pos_bits; idx->pos_mode = hd->pos_mode; idx->rev_mode = hd->rev_mode;
+    idx->k = hd->k; idx->pre = hd->pre; idx->tot = hd->tot; idx->tot_pos = hd->tot_pos;
+    idx->mm = mm; idx->mm_len = st.st_size;
+    idx->pa = (uint64_t*)(mm + hd->pa_off); idx->n_pa = hd->n_pa;
+    CALLOC(idx->idx_buf, idx->tot);
+    for (i = n_pa = 0; i < idx->tot; i++)
     {
-        flag += fread(&idx->idx_buf[i].n, sizeof(idx->idx_buf[i].n), 1, fp);
-        flag += fread(&idx->idx_buf[i].end, sizeof(idx->idx_buf[i].end), 1, fp);
-        MALLOC(idx->idx_buf[i].a, idx->idx_buf[i].n);
-        flag += fread(idx->idx_buf[i].a, sizeof(uint64_t), idx->idx_buf[i].n, fp);
-        hc_pt_load(&(idx->idx_buf[i].h), fp);
+        idx->idx_buf[i].n = bk[i].n; idx->idx_buf[i].end = bk[i].end;
+        idx->idx_buf[i].a = idx->pa + n_pa; n_pa += bk[i].n;
+        idx->idx_buf[i].h = hc_pt_init();
+        idx->idx_buf[i].h->bits = bk[i].bits; idx->idx_buf[i].h->count = bk[i].count;
+        n_b = bk[i].keys_off? 1U<<bk[i].bits : 0U;
+        if((bk[i].used_off && bk[i].used_off + __kh_fsize(n_b)*sizeof(khint32_t) > hd->dbug_off) || 
+            (bk[i].keys_off && bk[i].keys_off + n_b*sizeof(*(idx->idx_buf[i].h->keys)) > hd->dbug_off)) 
+        {
+            n_pa = (uint64_t)-1; break;
+        }
+        idx->idx_buf[i].h->used = bk[i].used_off? (khint32_t*)(mm + bk[i].used_off) : NULL;
+        idx->idx_buf[i].h->keys = bk[i].keys_off? (hc_pt_t_m_bucket_t*)(mm + bk[i].keys_off) : NULL;
     }
+    if(n_pa != hd->n_pa) goto renew;
 
+    fp = fopen(gfa_name, "r");
+    if(!fp || fseek(fp, hd->dbug_off, SEEK_SET) != 0 || !test_dbug(ug, fp)) goto renew;
 
+    fclose(fp); close(fd); free(gfa_name);
     (*r_idx) = idx;
+    // fprintf(stderr, "[M::%s::%.3f] ==> HiC index has been loaded\n", __func__, yak_realtime()-index_time);
+    return 1;
 
-    free(gfa_name);
-    if(!test_dbug(ug, fp))
+    renew:
+    if(fp) fclose(fp);
+    if(idx) 
     {
-        destory_hc_pt_index(idx);
-        free(idx);
-        (*r_idx) = NULL;
-        fclose(fp);
-        fprintf(stderr, "[M::%s::] ==> Renew Hi-C index\n", __func__);
-        return 0;
+        destory_hc_pt_index(idx); free(idx);
     }
-
-    fclose(fp);
-    // fprintf(stderr, "[M::%s::%.3f] ==> HiC index has been loaded\n", __func__, yak_realtime()-index_time);
-    return 1;
+    else if(mm)
+    {
+        munmap(mm, st.st_size);
+    }
+    close(fd); free(gfa_name);
+    fprintf(stderr, "[M::%s::] ==> Renew Hi-C index\n", __func__);
+    return 0;
 }
 
 static void worker_for_sort(void *data, long i, int tid) // callback for kt_for()
@@ -634,14 +809,24 @@ static void worker_for_sort(void *data, long i, int tid) // callback for kt_for(
 
 }
 
+static void worker_for_gen(void *data, long i, int tid) // callback for kt_for()
+{
+    ha_ug_index *idx = (ha_ug_index*)data;
+    hc_pt_t_gen_single(&(idx->idx_buf[i]), &(idx->up_bound), &(idx->low_bound));
+}
+
 void hc_pt_t_gen(ha_ug_index* idx, pldat_t* pl)
 {
     if(pl == NULL)
     {
-        uint64_t i;
-        for (i = 0; i < idx->tot; i++)
+        uint64_t i, n_thread = asm_opt.thread_num>0?asm_opt.thread_num:1;
+        kt_for(n_thread, worker_for_gen, idx, idx->tot);
+        for (i = idx->n_pa = 0; i < idx->tot; i++) idx->n_pa += idx->idx_buf[i].n;
+        CALLOC(idx->pa, idx->n_pa + 1);
+        for (i = idx->n_pa = 0; i < idx->tot; i++)
         {
-            hc_pt_t_gen_single(&(idx->idx_buf[i]), &(idx->up_bound), &(idx->low_bound));
+            idx->idx_buf[i].a = idx->pa + idx->n_pa;
+            idx->n_pa += idx->idx_buf[i].n;
         }
     }
     else
@@ -654,120 +839,72 @@ static void worker_for(void *data, long i, int tid) // callback for kt_for()
 {
 	pldat_t *pl = (pldat_t*)data;
     hc_pt1_t *h = &(pl->h->idx_buf[i]);
-    uint64_t m = 0, beg, end, occ;
+    uint64_t m = 0, beg, end, occ, t;
     khint_t key;
     int absent;
+    uint64_t* cnt = NULL;
+    kvec_cnt *c = &(pl->cnt[i]);
+    ///merge the buffers of all threads into the one of thread 0
+    for (t = 1; t < pl->n_thread; t++)
+    {
+        kvec_cnt *z = &(pl->cnt[t*pl->h->tot+i]);
+        if(z->a.n == 0) continue;
+        kv_resize(uint64_t, c->a, c->a.n + z->a.n);
+        memcpy(c->a.a + c->a.n, z->a.a, z->a.n*sizeof(uint64_t));
+        c->a.n += z->a.n; z->a.n = 0;
+    }
     
-    
-    if(pl->is_cnt)
+    if(c->a.n > 2) radix_sort_b64(c->a.a, c->a.a + c->a.n);
+    cnt = c->a.a;
+    occ = c->a.n;
+    for (m = beg = end = 0; m < occ; m++)
     {
-        uint64_t* cnt = NULL;
-        if(pl->cnt[i].a.n > 2) radix_sort_b64(pl->cnt[i].a.a, pl->cnt[i].a.a + pl->cnt[i].a.n);
-        cnt = pl->cnt[i].a.a;
-        occ = pl->cnt[i].a.n;
-        for (m = beg = end = 0; m < occ; m++)
+        if(cnt[beg] == cnt[m])
         {
-            if(cnt[beg] == cnt[m])
-            {
-                end = m;
-            }
-            else
-            {
-                key = hc_pt_put(h->h, cnt[beg], &absent);
-                if(absent) kh_val(h->h, key) = 0;
-                kh_val(h->h, key) += (end - beg + 1);
-                kh_key(h->h, key) = (kh_key(h->h, key)&HIC_KEY_MODE)|
-                        (kh_val(h->h, key)<HIC_MAX_COUNT?kh_val(h->h, key):HIC_MAX_COUNT);
-                beg = end = m;
-            }
+            end = m;
         }
-        if(occ > 0)
+        else
         {
             key = hc_pt_put(h->h, cnt[beg], &absent);
             if(absent) kh_val(h->h, key) = 0;
             kh_val(h->h, key) += (end - beg + 1);
             kh_key(h->h, key) = (kh_key(h->h, key)&HIC_KEY_MODE)|
-                        (kh_val(h->h, key)<HIC_MAX_COUNT?kh_val(h->h, key):HIC_MAX_COUNT);
+                    (kh_val(h->h, key)<HIC_MAX_COUNT?kh_val(h->h, key):HIC_MAX_COUNT);
+            beg = end = m;
         }
-        pl->cnt[i].a.n = 0;
-    } 
-    
-    if(!pl->is_cnt) 
+    }
+    if(occ > 0)
     {
-        ch_buf_t* pos = NULL;
-        uint64_t num, *pos_list = NULL, k, k_n, pos_k;
-        if(pl->buf[i].a.n > 2) radix_sort_ch_buf(pl->buf[i].a.a, pl->buf[i].a.a + pl->buf[i].a.n);
-        pos = pl->buf[i].a.a;
-        occ = pl->buf[i].a.n;
-        for (m = beg = end = 0; m < occ; m++)
-        {
-            if(pos[beg].key == pos[m].key)
-            {
-                end = m;
-            }
-            else
-            {
-                num = get_hc_pt1_count(pl->h, pos[beg].key, &pos_list);
-                if(num > 0)
-                {
-                    k_n=(end-beg+1);pos_k=pos_list[num-1];pos_list[num-1]+=k_n;
-                    for (k = 0; k < k_n; k++)
-                    {
-                        pos_list[pos_k+k] = pos[beg+k].pos;
-                    }
-                }
-                
-                beg = end = m;
-            }
-            
-        }
-        if(occ > 0)
-        {
-            num = get_hc_pt1_count(pl->h, pos[beg].key, &pos_list);
-            if(num > 0)
-            {
-                k_n=(end-beg+1);pos_k=pos_list[num-1];pos_list[num-1]+=k_n;
-                for (k = 0; k < k_n; k++)
-                {
-                    pos_list[pos_k+k] = pos[beg+k].pos;
-                }
-            }
-        }
-        pl->buf[i].a.n = 0;
+        key = hc_pt_put(h->h, cnt[beg], &absent);
+        if(absent) kh_val(h->h, key) = 0;
+        kh_val(h->h, key) += (end - beg + 1);
+        kh_key(h->h, key) = (kh_key(h->h, key)&HIC_KEY_MODE)|
+                    (kh_val(h->h, key)<HIC_MAX_COUNT?kh_val(h->h, key):HIC_MAX_COUNT);
     }
+    c->a.n = 0;
 }
 
-void parallel_count_hc_pt1(pldat_t* pl)
+static void worker_for_scan(void *data, long i, int tid) // callback for kt_for()
 {
-    uint64_t i, l = 0, uID, num_pos = 0, pos_thre;
-    uint64_t x[4], mask = (1ULL<<pl->h->k) - 1, shift = pl->h->k - 1, hash, pos, skip, bucket_mask = (1ULL<<pl->h->pre) - 1;
-    ma_utg_t *u = NULL;
-    ch_buf_t k_pos;
-    if(pl->is_cnt) l = ((pl->buf_bytes>>3)/pl->h->tot) + 1, pos_thre = pl->buf_bytes>>3;
-    if(!pl->is_cnt) l = ((pl->buf_bytes>>4)/pl->h->tot) + 1, pos_thre = pl->buf_bytes>>4;
-    for (i = 0; i < pl->h->tot; i++)
-    {
-        if(pl->is_cnt)
-        {
-            kv_resize(uint64_t, pl->cnt[i].a, l);
-            pl->cnt[i].a.n = 0;
-        } 
-        
-        if(!pl->is_cnt)
-        {
-            kv_resize(ch_buf_t, pl->buf[i].a, l);
-            pl->buf[i].a.n = 0;
-        } 
-    }
-        
-     
-    for (uID = 0; uID < pl->h->ug->u.n; uID++)
-    {
-        u = &(pl->h->ug->u.a[uID]);
-        if(u->m == 0) continue;
-
-        for (i = l = 0, x[0] = x[1] = x[2] = x[3] = 0; i < u->len; ++i) {
-        int c = seq_nt4_table[(uint8_t)u->s[i]];
+    pldat_t *pl = (pldat_t*)data;
+    ha_ug_index *h = pl->h;
+    uint64_t uID = pl->seg[i]>>32, st = (uint32_t)pl->seg[i], en, beg, j, l;
+    uint64_t x[4], mask = (1ULL<<h->k) - 1, shift = h->k - 1, hash, pos, skip, bucket_mask = (1ULL<<h->pre) - 1;
+    uint64_t num, *pos_list = NULL;
+    ma_utg_t *u = &(h->ug->u.a[uID]);
+    char *us = u->s;
+    en = st + HC_SEG_LEN; if(en > u->len) en = u->len;
+    ///k-mers ending in [st, en)
+    beg = st + 1 >= h->k? st + 1 - h->k : 0;
+    if(!us) 
+    {
+        kv_resize(char, pl->ub[tid], en - beg); 
+        ma_ug_pseq_retrieve(h->ps, uID, 0, beg, en - beg, pl->ub[tid].a);
+        us = pl->ub[tid].a - beg;
+    }
+
+    for (j = beg, l = 0, x[0] = x[1] = x[2] = x[3] = 0; j < en; ++j) {
+        int c = seq_nt4_table[(uint8_t)us[j]];
         ///c = 00, 01, 10, 11
         if (c < 4) { // not an "N" base
             ///x[0] & x[1] are the forward k-mer
@@ -776,48 +913,65 @@ void parallel_count_hc_pt1(pldat_t* pl)
             x[1] = (x[1] << 1 | (c>>1)) & mask;
             x[2] = x[2] >> 1 | (uint64_t)(1 - (c&1))  << shift;
             x[3] = x[3] >> 1 | (uint64_t)(1 - (c>>1)) << shift;
-            if (++l >= pl->h->k)
+            if (++l >= h->k && j >= st)
             {
-                hash = hc_hash_long(x, &skip, pl->h->k);
+                hash = hc_hash_long(x, &skip, h->k);
                 if(skip == (uint64_t)-1) continue;
                 if(pl->is_cnt)
                 {
-                    kv_push(uint64_t, pl->cnt[hash & bucket_mask].a, hash);
+                    kv_push(uint64_t, pl->cnt[tid*h->tot + (hash & bucket_mask)].a, hash);
                 }
                 else
                 {
-                    pos = (skip << 63) | ((uID << (64-pl->h->uID_bits))>>1) | (i & pl->h->pos_mode);
-                    k_pos.key = hash; k_pos.pos = pos;
-                    kv_push(ch_buf_t, pl->buf[hash & bucket_mask].a, k_pos);
-                }
-                num_pos++;
-
-                if(num_pos >= pos_thre)
-                {
-                    num_pos = 0;
-                    kt_for(pl->n_thread, worker_for, pl, pl->h->tot);
+                    num = get_hc_pt1_count(h, hash, &pos_list);
+                    if(num == 0) continue;
+                    ///the last slot of a k-mer keeps the number of filled slots until it is filled
+                    pos = __sync_fetch_and_add(&(pos_list[num-1]), 1);
+                    pos_list[pos] = (skip << 63) | ((uID << (64-h->uID_bits))>>1) | (j & h->pos_mode);
                 }
             }
-                
         } else l = 0, x[0] = x[1] = x[2] = x[3] = 0; // if there is an "N", restart
     }
-    }
+}
 
-    if(num_pos > 0) kt_for(pl->n_thread, worker_for, pl, pl->h->tot);
+void parallel_count_hc_pt1(pldat_t* pl)
+{
+    uint64_t i, st, n_base, pos_thre = pl->buf_bytes>>3, *seg = pl->seg, n_seg = pl->n_seg;
+    ma_utg_t *u = NULL;
+    if(!pl->is_cnt)
+    {
+        ///positions go to their final slots directly
+        kt_for(pl->n_thread, worker_for_scan, pl, pl->n_seg);
+    }
+    else
+    {
+        ///k-mers are collected into per-thread buffers for a batch of segments, then counted per bucket
+        for (st = i = n_base = 0; i < n_seg; i++)
+        {
+            u = &(pl->h->ug->u.a[seg[i]>>32]);
+            n_base += MIN(HC_SEG_LEN, u->len - (uint32_t)seg[i]);
+            if(n_base < pos_thre && i + 1 < n_seg) continue;
+            pl->seg = seg + st; pl->n_seg = i + 1 - st;
+            kt_for(pl->n_thread, worker_for_scan, pl, pl->n_seg);
+            kt_for(pl->n_thread, worker_for, pl, pl->h->tot);
+            st = i + 1; n_base = 0;
+        }
+        pl->seg = seg; pl->n_seg = n_seg;
+    }
 
-    for (i = 0; i < pl->h->tot; i++)
+    for (i = 0; i < pl->h->tot*pl->n_thread; i++)
     {
         if(pl->cnt[i].a.m > 0) kv_destroy(pl->cnt[i].a), kv_init(pl->cnt[i].a);
-        if(pl->buf[i].a.m > 0) kv_destroy(pl->buf[i].a), kv_init(pl->buf[i].a);
     }
 }
 
-ha_ug_index* build_unitig_index(ma_ug_t *ug, int k, uint64_t up_occ, uint64_t low_occ, uint64_t thread_num)
+ha_ug_index* build_unitig_index(ma_ug_t *ug, ma_ug_pseq_t *ps, int k, uint64_t up_occ, uint64_t low_occ, uint64_t thread_num)
 {
     ha_ug_index* idx = NULL; CALLOC(idx, 1);
-    pldat_t pl; pl.h = idx; pl.is_cnt = 1;
+    pldat_t pl; memset(&pl, 0, sizeof(pl)); pl.h = idx; pl.is_cnt = 1;
     double index_time = yak_realtime(), beg_time;
     init_ha_ug_index_opt(idx, ug, k, &pl, up_occ, low_occ, thread_num);
+    idx->ps = ps;
 
     beg_time = yak_realtime();
     pl.is_cnt = 1;
@@ -840,12 +994,9 @@ ha_ug_index* build_unitig_index(ma_ug_t *ug, int k, uint64_t up_occ, uint64_t lo
     fprintf(stderr, "[M::%s::%.3f] ==> HiC index has been built\n", __func__, yak_realtime()-index_time);
     
     uint64_t i;
-    for (i = 0; i < idx->tot; i++)
-    {
-        kv_destroy(pl.cnt[i].a);
-        kv_destroy(pl.buf[i].a);
-    }
-    free(pl.cnt); free(pl.buf);
+    for (i = 0; i < idx->tot*pl.n_thread; i++) kv_destroy(pl.cnt[i].a);
+    for (i = 0; i < pl.n_thread; i++) kv_destroy(pl.ub[i]);
+    free(pl.cnt); free(pl.ub); free(pl.seg);
 
     return idx;
 }
@@ -857,11 +1008,16 @@ void destory_hc_pt_index(ha_ug_index* idx)
         uint64_t i = 0;
         for (i = 0; i < idx->tot; i++)
         {
-            if(idx->idx_buf[i].a) free(idx->idx_buf[i].a);
-            if(idx->idx_buf[i].h) hc_pt_destroy(idx->idx_buf[i].h);
+            if(idx->idx_buf[i].a && !idx->pa) free(idx->idx_buf[i].a);
+            if(idx->idx_buf[i].h && idx->mm) free(idx->idx_buf[i].h);///tables are in the mapping
+            else if(idx->idx_buf[i].h) hc_pt_destroy(idx->idx_buf[i].h);
         }
         free(idx->idx_buf);
     }
+    if(idx->mm) munmap(idx->mm, idx->mm_len);
+    else free(idx->pa);
+    free(idx->flt); idx->flt = NULL;
+    idx->idx_buf = NULL; idx->pa = NULL; idx->mm = NULL;
 }
 
 inline void interpret_pos(const ha_ug_index* idx, s_hit *p, uint64_t* rev, uint64_t* uID, 
@@ -888,7 +1044,7 @@ uint64_t* ref_p, uint64_t* self_p, uint64_t* exact_len, uint64_t* total_len)
 }
 
 
-inline uint64_t check_exact_match(char* a, long long a_beg, long long a_total, char* b, long long b_beg, 
+inline uint64_t check_exact_match(char* a, long long a_beg, long long a_total, const ha_ug_index* idx, uint64_t uID, long long b_beg, 
 long long b_total, long long Len, uint64_t rev, uint64_t dir)
 {
     long long i = 0;
@@ -898,14 +1054,16 @@ long long b_total, long long Len, uint64_t rev, uint64_t dir)
         {
             for (i = 0; i < Len && a_beg < a_total && b_beg < b_total; i++)
             {
-                if(a[a_beg++] != b[b_beg++]) return i;
+                if(a[a_beg] != hc_ubase(idx, uID, b_beg)) return i;
+                a_beg++; b_beg++;
             }
         }
         else
         {
             for (i = 0; i < Len && a_beg >= 0 && b_beg >= 0; i++)
             {
-                if(a[a_beg--] != b[b_beg--]) return i;
+                if(a[a_beg] != hc_ubase(idx, uID, b_beg)) return i;
+                a_beg--; b_beg--;
             }
         }
     }
@@ -916,7 +1074,7 @@ long long b_total, long long Len, uint64_t rev, uint64_t dir)
         {
             for (i = 0; i < Len && a_beg < a_total && b_beg < b_total; i++)
             {
-                if(a[a_beg] != b2rc[seq_nt4_table[(uint8_t)b[b_total - b_beg - 1]]]) return i;
+                if(a[a_beg] != b2rc[seq_nt4_table[(uint8_t)hc_ubase(idx, uID, b_total - b_beg - 1)]]) return i;
                 a_beg++; b_beg++;
             }
         }
@@ -924,7 +1082,7 @@ long long b_total, long long Len, uint64_t rev, uint64_t dir)
         {
             for (i = 0; i < Len && a_beg >= 0 && b_beg >= 0; i++)
             {
-                if(a[a_beg] != b2rc[seq_nt4_table[(uint8_t)b[b_total - b_beg - 1]]]) return i;
+                if(a[a_beg] != b2rc[seq_nt4_table[(uint8_t)hc_ubase(idx, uID, b_total - b_beg - 1)]]) return i;
                 a_beg--; b_beg--;
             }
         }
@@ -1080,14 +1238,14 @@ uint64_t *pos_list, uint64_t cnt, uint64_t* c_sfx)
 
 
         ///extend
-        k_len = check_exact_match(r, self_p + 1, len, idx->ug->u.a[uID].s, ref_p + 1, u_len, len, rev, 0);
+        k_len = check_exact_match(r, self_p + 1, len, idx, uID, ref_p + 1, u_len, len, rev, 0);
         if(c_sfx && cnt == idx->hap_cnt && k_len < (*c_sfx)) (*c_sfx) = k_len;
         
         p->off_cnt += ((uint64_t)k_len << 32) + k_len;
 
         if(self_p >= k_mer && ref_p >= k_mer)
         {
-            k_len = check_exact_match(r, self_p - k_mer, len, idx->ug->u.a[uID].s, 
+            k_len = check_exact_match(r, self_p - k_mer, len, idx, uID, 
                                                     ref_p - k_mer, u_len, len, rev, 1);
             p->off_cnt += ((uint64_t)k_len << 32);
         }
@@ -1256,7 +1414,7 @@ inline void compress_mapped_pos_advance(const ha_ug_index* idx, kvec_vote* buf,
 
 void get_alignment(char *r, uint64_t len, uint64_t k_mer, kvec_vote* buf, const ha_ug_index* idx, uint64_t buf_iter, uint64_t rid)
 {
-    uint64_t i, j, k, l = 0, k_len, c_sfx, m, skip, *pos_list = NULL, cnt, rev, self_p, ref_p, uID;
+    uint64_t i, l = 0, k_len, c_sfx, m, skip, *pos_list = NULL, cnt, rev, self_p, ref_p, uID;
     uint64_t x[4], mask = (1ULL<<k_mer) - 1, shift = k_mer - 1, hash;
     ///buf->a.n = 0;
     for (i = l = 0, x[0] = x[1] = x[2] = x[3] = 0; i < len; ++i) {
@@ -1273,23 +1431,9 @@ void get_alignment(char *r, uint64_t len, uint64_t k_mer, kvec_vote* buf, const
             {
                 hash = hc_hash_long(x, &skip, k_mer);
                 if(skip == (uint64_t)-1) continue;
+                if(!hc_flt_test(idx, hash)) continue;
                 cnt = get_hc_pt1_count((ha_ug_index*)idx, hash, &pos_list);
-                if(cnt > idx->hap_cnt || cnt <= 0) continue;
-
-                if(cnt > 1)
-                {
-                    for (j = 0; j < cnt; j++)
-                    {
-                        uID = (pos_list[j] << 1) >> (64 - idx->uID_bits);
-                        for (k = j + 1; k < cnt; k++)
-                        {
-                            if(uID == ((pos_list[k] << 1) >> (64 - idx->uID_bits))) break;
-                        }
-                        if(k < cnt) break;
-                    }
-
-                    if(j < cnt) continue;
-                }
+                if(!hc_kmer_placeable(idx, cnt, pos_list)) continue;
                 // if(cnt > 0) fprintf(stderr, "+i: %lu, l: %lu, cnt: %lu\n", i, l, cnt);
                 get_longest_hit(r, len, k_mer, i, skip, buf, idx, pos_list, cnt, &c_sfx);
                 // if(cnt > 0) fprintf(stderr, "c_sfx: %lu\n", c_sfx);
@@ -1552,7 +1696,7 @@ void get_alignment_debug(char *r, uint64_t len, uint64_t k_mer, kvec_vote* buf,
                 {
                     ///uint64_t debug_right = 0, debug_left = 0, debug_len;
 
-                    j = check_exact_match(r, self_p + 1, len, idx->ug->u.a[uID].s, ref_p + 1, u_len, len, rev, 0);
+                    j = check_exact_match(r, self_p + 1, len, idx, uID, ref_p + 1, u_len, len, rev, 0);
                     
                     ///debug_right = j;
                     ///if(j == 0) continue;
@@ -1570,14 +1714,14 @@ void get_alignment_debug(char *r, uint64_t len, uint64_t k_mer, kvec_vote* buf,
 
                     if(self_p >= k_mer && ref_p >= k_mer)
                     {
-                        j = check_exact_match(r, self_p - k_mer, len, idx->ug->u.a[uID].s, 
+                        j = check_exact_match(r, self_p - k_mer, len, idx, uID, 
                                                                 ref_p - k_mer, u_len, len, rev, 1);
                         buf->a.a[buf->a.n-1].off_cnt += ((uint64_t)j << 32);
                         ///debug_left = j;
                     }
 
 
-                    // debug_len = check_exact_match(r, self_p + debug_right, len, idx->ug->u.a[uID].s, 
+                    // debug_len = check_exact_match(r, self_p + debug_right, len, idx, uID, 
                     // ref_p + debug_right, u_len, len, rev, 1);
                     // if(debug_len!= (debug_left + debug_right + k_mer))
                     // {
@@ -1930,6 +2074,9 @@ static void worker_for_alignment(void *data, long i, int tid) // callback for kt
     char *r1 = s->seq[i], *r2 = s->seq[i] + len1;
 
 
+    ///both mates have to be placed; skip the pair early if either cannot be
+    if(!hc_mate_flt(r2, len2, s->idx) || !hc_mate_flt(r1, len1, s->idx)) return;
+
     // fprintf(stderr, "**********R1**********\n");
     s->pos_buf[tid].a.n = 0;
     get_alignment(r1, len1, s->idx->k, &s->pos_buf[tid], s->idx, 0, s->id+i);
@@ -1973,33 +2120,75 @@ static void worker_for_alignment(void *data, long i, int tid) // callback for kt
     /*******************************for debug************************************/
 }
 
+static void spill_hits(sldat_t *p);
+
+static void worker_read_mate(void *data, long i, int tid) // callback for kt_for()
+{
+    hc_mate_buf_t *b = &(((hc_mate_buf_t*)data)[i]);
+    b->n = b->off.n = b->s.n = 0;
+    while (b->n < b->n_max && kseq_read(b->ks) >= 0) {
+        kv_push(uint64_t, b->off, b->s.n);
+        kv_resize(char, b->s, b->s.n + b->ks->seq.l);
+        memcpy(b->s.a + b->s.n, b->ks->seq.s, b->ks->seq.l);
+        b->s.n += b->ks->seq.l; b->n++;
+    }
+    kv_push(uint64_t, b->off, b->s.n);
+}
+
+static void push_pe_read(stepdat_t *s, const char *s1, uint64_t l1, const char *s2, uint64_t l2)
+{
+    if (s->n == s->m) {
+        s->m = s->m < 16? 16 : s->m + (s->n>>1);
+        REALLOC(s->len, s->m);
+        REALLOC(s->seq, s->m);
+    }
+    MALLOC(s->seq[s->n], l1+l2);
+    s->sum_len += l1+l2;
+    memcpy(s->seq[s->n], s1, l1);
+    memcpy(s->seq[s->n]+l1, s2, l2);
+    s->len[s->n++] = (uint64_t)(l1<<32)|(uint64_t)l2;
+}
+
+///read the next chunk of R1 and R2 in parallel; returns 0 at the end of either file
+static int read_pe_chunk_mt(sldat_t *p, stepdat_t *s)
+{
+    uint64_t k, n, l1, l2; hc_mate_buf_t *b1 = &(p->mb[0]), *b2 = &(p->mb[1]);
+    while (!p->is_eof && s->sum_len < p->chunk_size) {
+        b1->n_max = b2->n_max = p->n_pair_b;
+        kt_for(p->n_io, worker_read_mate, p->mb, 2);
+        n = MIN(b1->n, b2->n);
+        if(n < p->n_pair_b) p->is_eof = 1;
+        for (k = 0; k < n; k++) {
+            l1 = b1->off.a[k+1] - b1->off.a[k]; l2 = b2->off.a[k+1] - b2->off.a[k];
+            if (l1 < p->idx->k || l2 < p->idx->k) continue;
+            push_pe_read(s, b1->s.a + b1->off.a[k], l1, b2->s.a + b2->off.a[k], l2);
+        }
+    }
+    return s->sum_len > 0;
+}
+
 static void *worker_pipeline(void *data, int step, void *in) // callback for kt_pipeline()
 {
     sldat_t *p = (sldat_t*)data;
     ///uint64_t total_base = 0, total_pair = 0;
     if (step == 0) { // step 1: read a block of sequences
         int ret1, ret2;
-        uint64_t l1, l2;
+        uint64_t n_pair = 0;
 		stepdat_t *s;
 		CALLOC(s, 1);
         s->idx = p->idx; s->id = p->total_pair; s->t_ch = p->t_ch;
-        while (((ret1 = kseq_read(p->ks1)) >= 0)&&((ret2 = kseq_read(p->ks2)) >= 0)) 
-        {
-            if (p->ks1->seq.l < p->idx->k || p->ks2->seq.l < p->idx->k) continue;
-            if (s->n == s->m) {
-                s->m = s->m < 16? 16 : s->m + (s->n>>1);
-                REALLOC(s->len, s->m);
-                REALLOC(s->seq, s->m);
+        if(p->n_pair_b) {
+            read_pe_chunk_mt(p, s);
+        } else {
+            while (((ret1 = kseq_read(p->ks1)) >= 0)&&((ret2 = kseq_read(p->ks2)) >= 0)) 
+            {
+                n_pair++;
+                if (p->ks1->seq.l < p->idx->k || p->ks2->seq.l < p->idx->k) continue;
+                push_pe_read(s, p->ks1->seq.s, p->ks1->seq.l, p->ks2->seq.s, p->ks2->seq.l);
+                if (s->sum_len >= p->chunk_size) break;            
             }
-
-            l1 = p->ks1->seq.l; l2 = p->ks2->seq.l;
-            MALLOC(s->seq[s->n], l1+l2);
-            s->sum_len += l1+l2;
-            memcpy(s->seq[s->n], p->ks1->seq.s, l1);
-            memcpy(s->seq[s->n]+l1, p->ks2->seq.s, l2);
-            s->len[s->n++] = (uint64_t)(l1<<32)|(uint64_t)l2;
-
-            if (s->sum_len >= p->chunk_size) break;            
+            ///the first chunk tells how many pairs to read per chunk
+            if(p->n_io > 1 && s->sum_len >= p->chunk_size) p->n_pair_b = n_pair;
         }
         p->total_pair += s->n;
         if (s->sum_len == 0) free(s);
@@ -2034,6 +2223,7 @@ static void *worker_pipeline(void *data, int step, void *in) // callback for kt_
         }
         free(s->pos);
         free(s);
+        if(p->spill_max && p->hits.a.n >= p->spill_max) spill_hits(p);
     }
     return 0;
 }
@@ -2156,49 +2346,130 @@ inline void swap_pe_hit_hap(pe_hit_hap* x, pe_hit_hap* y)
     tmp = (*x); (*x) = (*y); (*y) = tmp;
 }
 
-void dedup_hits(kvec_pe_hit* hits, uint64_t is_dup)
+#define HC_GRP_N_BLK 1024
+#define hc_grp_key(x, p) (((x).s<<(p)->sl)>>(p)->sr)
+
+typedef struct { // data structure for each step in kt_for()
+    pe_hit *a;
+    uint64_t *bd, *m;///block boundaries; number of hits kept in each block
+    uint64_t sl, sr, is_dup, is_idx;
+} hc_grp_sort_t;
+
+static void worker_for_grp_sort(void *data, long i, int tid) // callback for kt_for()
 {
-    double index_time = yak_realtime();
-    uint64_t k, l, m = 0, cur;
-    radix_sort_pe_hit_an1(hits->a.a, hits->a.a + hits->a.n);
-    for (k = 1, l = 0; k <= hits->a.n; ++k) 
+    hc_grp_sort_t *p = (hc_grp_sort_t*)data;
+    pe_hit *a = p->a;
+    uint64_t k, l, n = p->bd[i+1], m = p->bd[i], cur;
+    for (k = p->bd[i] + 1, l = p->bd[i]; k <= n; ++k) 
     {   
-        if (k == hits->a.n || hits->a.a[k].s != hits->a.a[l].s) 
+        if (k == n || hc_grp_key(a[k], p) != hc_grp_key(a[l], p)) 
         {
-            if (k - l > 1) radix_sort_pe_hit_an2(hits->a.a + l, hits->a.a + k);
-            if(is_dup)
+            if (k - l > 1) 
             {
-                cur = (uint64_t)-1;
-                while (l < k)
+                if(p->is_idx) radix_sort_pe_hit_idx_an2(a + l, a + k);
+                else radix_sort_pe_hit_an2(a + l, a + k);
+            }
+            if(p->is_dup)
+            {
+                ///the first hit of each (s, e) is kept
+                for (cur = (uint64_t)-1; l < k; l++)
                 {
-                    if(hits->a.a[l].e != cur)
-                    {
-                        cur = hits->a.a[l].e;
-                        hits->a.a[m++] = hits->a.a[l];
-                    }
-                    l++;
+                    if(a[l].e != cur) cur = a[l].e, a[m++] = a[l];
                 }
             }
             l = k;
         }
     }
-    if(is_dup) hits->a.n = m;
+    p->m[i] = p->is_dup? m - p->bd[i] : n - p->bd[i];
+}
+
+///a must have been sorted by s; sort each group of hits sharing hc_grp_key() by e in parallel
+///and, if is_dup, drop duplicated e within a group; return the number of remaining hits
+static uint64_t grp_sort_pe_hit(pe_hit *a, uint64_t n, uint64_t sl, uint64_t sr, uint64_t is_dup, uint64_t is_idx, uint64_t n_thread)
+{
+    hc_grp_sort_t p; uint64_t i, k, m;
+    p.a = a; p.sl = sl; p.sr = sr; p.is_dup = is_dup; p.is_idx = is_idx;
+    MALLOC(p.bd, HC_GRP_N_BLK + 1); CALLOC(p.m, HC_GRP_N_BLK);
+    ///blocks start at group boundaries
+    for (i = 0, p.bd[0] = 0; i < HC_GRP_N_BLK; i++)
+    {
+        k = n * (i + 1) / HC_GRP_N_BLK;
+        if(k < p.bd[i]) k = p.bd[i];
+        while (k > 0 && k < n && hc_grp_key(a[k], &p) == hc_grp_key(a[k-1], &p)) k++;
+        p.bd[i+1] = k;
+    }
+    kt_for(n_thread, worker_for_grp_sort, &p, HC_GRP_N_BLK);
+    for (i = m = 0; i < HC_GRP_N_BLK; i++)
+    {
+        if(m != p.bd[i] && p.m[i]) memmove(a + m, a + p.bd[i], p.m[i]*sizeof((*a)));
+        m += p.m[i];
+    }
+    free(p.bd); free(p.m);
+    return m;
+}
+
+///sort hits by (s, e); drop duplicated (s, e) if is_dup; return the number of remaining hits
+static uint64_t dedup_pe_hit(pe_hit *a, uint64_t n, uint64_t is_dup)
+{
+    uint64_t n_thread = asm_opt.thread_num>0?asm_opt.thread_num:1;
+    radix_sort_mt_pe_hit_an1(a, a + n, n_thread);
+    return grp_sort_pe_hit(a, n, 0, 0, is_dup, 0, n_thread);
+}
+
+void dedup_hits(kvec_pe_hit* hits, uint64_t is_dup)
+{
+    double index_time = yak_realtime();
+    hits->a.n = dedup_pe_hit(hits->a.a, hits->a.n, is_dup);
     fprintf(stderr, "[M::%s::%.3f] ==> Dedup\n", __func__, yak_realtime()-index_time);
 }
 
+static void get_spill_name(char *fn, uint64_t id)
+{
+    sprintf(fn, "%s.hic.tmp.%lu.bin", asm_opt.output_file_name, (unsigned long)id);
+}
+
+///write the sorted and deduplicated hits held in memory as a new run on disk
+static void spill_hits(sldat_t *p)
+{
+    char *fn = (char*)malloc(strlen(asm_opt.output_file_name)+50);
+    FILE *fp; uint64_t n;
+    n = dedup_pe_hit(p->hits.a.a, p->hits.a.n, 1);
+    get_spill_name(fn, p->n_spill);
+    fp = fopen(fn, "wb");
+    if(!fp) {
+        fprintf(stderr, "[ERROR::%s] cannot write %s\n", __func__, fn);
+        exit(1);
+    }
+    fwrite(&n, sizeof(n), 1, fp);
+    fwrite(p->hits.a.a, sizeof((*(p->hits.a.a))), n, fp);
+    fclose(fp); free(fn);
+    p->n_spill++; p->hits.a.n = 0;
+}
+
+#define HC_MERGE_BUF 65536
+
+typedef struct {
+    FILE *fp;
+    uint64_t n_left, i, n;
+    pe_hit *a;
+} hc_run_t;
+
+static int hc_run_next(hc_run_t *r)
+{
+    if(r->i < r->n) return 1;
+    if(r->n_left == 0) return 0;
+    r->n = MIN(r->n_left, (uint64_t)HC_MERGE_BUF); r->i = 0;
+    if(fread(r->a, sizeof((*(r->a))), r->n, r->fp) != r->n) return r->n = 0, r->n_left = 0, 0;
+    r->n_left -= r->n;
+    return 1;
+}
+
 void sort_hits(kvec_pe_hit* hits)
 {
     double index_time = yak_realtime();
-    uint64_t k, l;
-    radix_sort_pe_hit_an1(hits->a.a, hits->a.a + hits->a.n);
-    for (k = 1, l = 0; k <= hits->a.n; ++k) 
-    {   
-        if (k == hits->a.n || (hits->a.a[k].s<<1) != (hits->a.a[l].s<<1)) 
-        {
-            if (k - l > 1) radix_sort_pe_hit_an2(hits->a.a + l, hits->a.a + k);
-            l = k;
-        }
-    }
+    uint64_t n_thread = asm_opt.thread_num>0?asm_opt.thread_num:1;
+    radix_sort_mt_pe_hit_an1(hits->a.a, hits->a.a + hits->a.n, n_thread);
+    grp_sort_pe_hit(hits->a.a, hits->a.n, 1, 0, 0, 0, n_thread);
     fprintf(stderr, "[M::%s::%.3f] ==> Sort\n", __func__, yak_realtime()-index_time);
 }
 
@@ -3524,30 +3795,84 @@ void get_shortest_path(uint32_t src, pdq* pq, asg_t *sg, uint32_t* pre)
     }
 }
 
-void all_pair_shortest_path(asg_t *sg, hc_links* link, MT* M)
+///same as get_shortest_path(), but over the packed arcs of a read-only snapshot;
+///vs keeps the reached vertices, so that only they are reset by the next call 
+///instead of the whole pq (pq must be reset before the first call)
+void get_shortest_path_csr(uint32_t src, pdq* pq, const asg_csr_t *cg, asg32_v *vs)
 {
-    hc_linkeage* t = NULL;
-    pdq pq;
-    init_pdq(&pq, sg->n_seq<<1);
-    uint32_t n_vtx = sg->n_seq<<1, v;
-    uint64_t k, *p = NULL;
-
-    for (v = 0; v < n_vtx; ++v)
+    uint64_t v, u, i, nv, w;
+    const uint32_t *cv, *cl;
+    for (i = 0; i < vs->n; i++) pq->dis.a[vs->a[i]] = (uint64_t)-1, pq->vis.a[vs->a[i]] = 0;
+    pq->x.n = 1; pdq_cnt(*pq) = 0; vs->n = 0;
+    pq->dis.a[src] = 0; kv_push(uint32_t, *vs, src);
+    push_pdq(pq, src, 0);
+    while (pdq_cnt(*pq) > 0)
     {
-        if (sg->seq[v>>1].del) continue;
-        t = &(link->a.a[v>>1]);
-        if (t->e.n == 0) continue;
-        get_shortest_path(v, &pq, sg, NULL);
-        for (k = 0; k < pq.dis.n; k++)
+        pop_pdq(pq, &v, &w);
+        pq->vis.a[v] = 1;
+
+        cv = asg_csr_v(cg, v); cl = asg_csr_len(cg, v);
+        nv = asg_csr_n(cg, v);
+
+        for (i = 0; i < nv; i++)
         {
-            if(pq.dis.a[k] == (uint64_t)-1) continue;
-            kv_pushp(uint64_t, M->matrix.a[v].a, &p);
-            (*p) = k << M->uID_shift;
-            (*p) = (*p) | pq.dis.a[k];
+            u = cv[i]; w = cl[i];
+            if(pq->vis.a[u] == 0 && pq->dis.a[u] > pq->dis.a[v] + w)
+            {
+                if(pq->dis.a[u] == (uint64_t)-1) kv_push(uint32_t, *vs, u);
+                pq->dis.a[u] = pq->dis.a[v] + w;
+                push_pdq(pq, u, pq->dis.a[u]);
+            }
         }
     }
-    
-    destory_pdq(&pq);
+}
+
+typedef struct { // data structure for each step in kt_for()
+    asg_t *sg;
+    const asg_csr_t *cg;
+    hc_links* link;
+    MT* M;
+    pdq *pq; ///one per thread
+    asg32_v *vs; ///one per thread
+} utg_sp_t;
+
+static void worker_for_sp(void *data, long i, int tid) // callback for kt_for()
+{
+    utg_sp_t *s = (utg_sp_t*)data;
+    pdq *pq = &(s->pq[tid]); asg32_v *vs = &(s->vs[tid]);
+    kvec_t_u64_warp *r = &(s->M->matrix.a[i]);
+    uint64_t k;
+
+    if (s->sg->seq[i>>1].del) return;
+    if (s->link->a.a[i>>1].e.n == 0) return;
+    get_shortest_path_csr(i, pq, s->cg, vs);
+    ///rows are sorted by vertex id, as get_LCA() and worker_for_dis() search them
+    radix_sort_u32(vs->a, vs->a + vs->n);
+    kv_resize(uint64_t, r->a, r->a.n + vs->n);
+    for (k = 0; k < vs->n; k++) {
+        r->a.a[r->a.n++] = (((uint64_t)vs->a[k]) << s->M->uID_shift) | pq->dis.a[vs->a[k]];
+    }
+}
+
+///rows of M are only filled for vertices with Hi-C links, but hold every vertex they reach: 
+///get_LCA() takes the minimum over all common ancestors, so rows cannot be pruned by distance
+void all_pair_shortest_path(asg_t *sg, hc_links* link, MT* M)
+{
+    utg_sp_t s; uint32_t i;
+    s.sg = sg; s.link = link; s.M = M;
+    s.cg = asg_csr_gen(sg);
+    CALLOC(s.pq, asm_opt.thread_num); CALLOC(s.vs, asm_opt.thread_num);
+    for (i = 0; i < (uint32_t)asm_opt.thread_num; i++) {
+        init_pdq(&(s.pq[i]), sg->n_seq<<1); reset_pdq(&(s.pq[i]));
+    }
+
+    kt_for(asm_opt.thread_num, worker_for_sp, &s, sg->n_seq<<1);
+
+    for (i = 0; i < (uint32_t)asm_opt.thread_num; i++) {
+        destory_pdq(&(s.pq[i])); free(s.vs[i].a);
+    }
+    free(s.pq); free(s.vs);
+    asg_csr_destroy((asg_csr_t*)s.cg);
 }
 
 typedef struct{
@@ -3727,12 +4052,26 @@ uint64_t LCA_distance(long long d_x, long long d_y, long long xLen, long long yL
     return t_end + 1 - t_beg;
 }
 
-uint64_t get_LCA_bubble(uint32_t x, uint64_t xLen, uint32_t y, uint64_t yLen, uint8_t* dis, uint64_t n, MT* M, bubble_type* bub, uint64_t* min_rev)
+///distance from the source of row r to v; rows are sorted by vertex id
+static inline uint64_t get_MT_dis(const MT* M, const kvec_t_u64_warp *r, uint64_t v)
+{
+    uint64_t st = 0, ed = r->a.n, mid, u;
+    while (st < ed) {
+        mid = st + ((ed - st)>>1);
+        u = r->a.a[mid] >> M->uID_shift;
+        if(u == v) return r->a.a[mid] & M->dis_mode;
+        if(u < v) st = mid + 1;
+        else ed = mid;
+    }
+    return (uint64_t)-1;
+}
+
+uint64_t get_LCA_bubble(uint32_t x, uint64_t xLen, uint32_t y, uint64_t yLen, MT* M, bubble_type* bub, uint64_t* min_rev)
 {
-    uint32_t j, v, k;
-    uint64_t u, d = (uint64_t)-1, tmp;
+    uint32_t j, k;
+    uint64_t tmp, d_x, d_y, min_d = (uint64_t)-1;
+    uint32_t root[2], a_n, *a, min_j = (uint32_t)-1;
     uint8_t rev;
-    uint32_t root[2], a_n, *a;
     get_bubbles(bub, bub->index[x>>1], &root[0], &root[1], &a, &a_n, NULL);
     root[0] ^= 1; root[1] ^= 1;
     if(root[0] > root[1])
@@ -3742,56 +4081,13 @@ uint64_t get_LCA_bubble(uint32_t x, uint64_t xLen, uint32_t y, uint64_t yLen, ui
         root[1] = k;
     }
 
-    dis[root[0]] = (uint8_t)-1;
-    dis[root[1]] = (uint8_t)-1;
-
-    v = x;
-    for (j = 0; j < M->matrix.a[v].a.n; j++)
-    {
-        u = M->matrix.a[v].a.a[j] >> M->uID_shift;
-        d = M->matrix.a[v].a.a[j] & M->dis_mode;
-        dis[u] = dis[u] >> 4;
-    }
-
-    v = y;
-    for (j = 0; j < M->matrix.a[v].a.n; j++)
-    {
-        u = M->matrix.a[v].a.a[j] >> M->uID_shift;
-        d = M->matrix.a[v].a.a[j] & M->dis_mode;
-        dis[u] = dis[u] >> 4;
-    }
-    uint64_t x_i = 0, y_i = 0, d_x, d_y, min_d = (uint64_t)-1;
-    uint32_t min_j = (uint32_t)-1;
     (*min_rev) = (uint64_t)-1;
-
-
     for (k = 0; k < 2; k++)
     {
         j = root[k];
-        if(dis[j] != 0)
-        {
-            dis[j] = (uint8_t)-1;
-            continue;
-        } 
-        
-        for (; x_i < M->matrix.a[x].a.n; x_i++)
-        {
-            u = M->matrix.a[x].a.a[x_i] >> M->uID_shift;
-            d = M->matrix.a[x].a.a[x_i] & M->dis_mode;
-            if(u == j) break;
-        }
-        if(x_i == M->matrix.a[x].a.n && M->matrix.a[x].a.n != 0) fprintf(stderr, "ERROR X\n");
-        d_x = d;
-
-        for (; y_i < M->matrix.a[y].a.n; y_i++)
-        {
-            u = M->matrix.a[y].a.a[y_i] >> M->uID_shift;
-            d = M->matrix.a[y].a.a[y_i] & M->dis_mode;
-            if(u == j) break;
-        }
-        if(y_i == M->matrix.a[y].a.n && M->matrix.a[y].a.n != 0) fprintf(stderr, "ERROR Y\n");
-        d_y = d;
-
+        ///only roots reachable from both x and y
+        if((d_x = get_MT_dis(M, &(M->matrix.a[x]), j)) == (uint64_t)-1) continue;
+        if((d_y = get_MT_dis(M, &(M->matrix.a[y]), j)) == (uint64_t)-1) continue;
         tmp = LCA_distance(d_x, d_y, xLen, yLen, &rev);
         if(tmp < min_d) min_d = tmp, (*min_rev) = rev, min_j = j;
     }
@@ -3799,73 +4095,34 @@ uint64_t get_LCA_bubble(uint32_t x, uint64_t xLen, uint32_t y, uint64_t yLen, ui
     if(min_j == x || min_j == y) return (uint64_t)-1;
 
     return min_d;
-
-
 }
 
-uint64_t get_LCA(uint32_t x, uint64_t xLen, uint32_t y, uint64_t yLen, uint8_t* dis, uint64_t n, MT* M, bubble_type* bub, uint64_t* min_rev)
+uint64_t get_LCA(uint32_t x, uint64_t xLen, uint32_t y, uint64_t yLen, MT* M, bubble_type* bub, uint64_t* min_rev)
 {
     if(IF_BUB(x>>1, *bub) && IF_BUB(y>>1, *bub) && bub->index[x>>1] == bub->index[y>>1])
     {
-        return get_LCA_bubble(x, xLen, y, yLen, dis, n, M, bub, min_rev);
-    }
-    else
-    {
-        memset(dis, -1, sizeof(uint8_t)*n);
-    }
-
-    uint32_t j, v;
-    uint64_t u, d = (uint64_t)-1, tmp;
-    uint8_t rev;
-    
-    v = x;
-    for (j = 0; j < M->matrix.a[v].a.n; j++)
-    {
-        u = M->matrix.a[v].a.a[j] >> M->uID_shift;
-        d = M->matrix.a[v].a.a[j] & M->dis_mode;
-        dis[u] = dis[u] >> 4;
+        return get_LCA_bubble(x, xLen, y, yLen, M, bub, min_rev);
     }
 
-    v = y;
-    for (j = 0; j < M->matrix.a[v].a.n; j++)
-    {
-        u = M->matrix.a[v].a.a[j] >> M->uID_shift;
-        d = M->matrix.a[v].a.a[j] & M->dis_mode;
-        dis[u] = dis[u] >> 4;
-    }
-
-    uint64_t x_i = 0, y_i = 0, d_x, d_y, min_d = (uint64_t)-1;
+    ///both rows are sorted by vertex id; walk through the vertices reachable from both x and y
+    const kvec_t_u64_warp *mx = &(M->matrix.a[x]), *my = &(M->matrix.a[y]);
+    uint64_t x_i, y_i, ux, uy, tmp, min_d = (uint64_t)-1;
     uint32_t min_j = (uint32_t)-1;
+    uint8_t rev;
     (*min_rev) = (uint64_t)-1;
-    for (j = 0; j < n; j++)
-    {
-        if(dis[j] != 0)
-        {
-            dis[j] = (uint8_t)-1;
-            continue;
-        }
-
-        for (; x_i < M->matrix.a[x].a.n; x_i++)
-        {
-            u = M->matrix.a[x].a.a[x_i] >> M->uID_shift;
-            d = M->matrix.a[x].a.a[x_i] & M->dis_mode;
-            if(u == j) break;
-        }
-        if(x_i == M->matrix.a[x].a.n && M->matrix.a[x].a.n != 0) fprintf(stderr, "ERROR X\n");
-        d_x = d;
-
-        for (; y_i < M->matrix.a[y].a.n; y_i++)
-        {
-            u = M->matrix.a[y].a.a[y_i] >> M->uID_shift;
-            d = M->matrix.a[y].a.a[y_i] & M->dis_mode;
-            if(u == j) break;
+    for (x_i = y_i = 0; x_i < mx->a.n && y_i < my->a.n; )
+    {
+        ux = mx->a.a[x_i] >> M->uID_shift;
+        uy = my->a.a[y_i] >> M->uID_shift;
+        if(ux < uy) {
+            x_i++;
+        } else if(ux > uy) {
+            y_i++;
+        } else {
+            tmp = LCA_distance(mx->a.a[x_i] & M->dis_mode, my->a.a[y_i] & M->dis_mode, xLen, yLen, &rev);
+            if(tmp < min_d) min_d = tmp, (*min_rev) = rev, min_j = ux;
+            x_i++; y_i++;
         }
-        if(y_i == M->matrix.a[y].a.n && M->matrix.a[y].a.n != 0) fprintf(stderr, "ERROR Y\n");
-        d_y = d;
-
-
-        tmp = LCA_distance(d_x, d_y, xLen, yLen, &rev);
-        if(tmp < min_d) min_d = tmp, (*min_rev) = rev, min_j = j;
     }
 
     if(min_j == x || min_j == y) return (uint64_t)-1;
@@ -3878,7 +4135,6 @@ typedef struct { // data structure for each step in kt_pipeline()
     hc_links* link; 
     MT* M; 
     bubble_type* bub;
-    uint8_t** dis_buf;
 } utg_d_t;
 
 static void worker_for_dis(void *data, long i, int tid) 
@@ -3887,10 +4143,9 @@ static void worker_for_dis(void *data, long i, int tid)
     hc_links* link = s->link;
     MT* M = s->M; 
     bubble_type* bub = s->bub;
-    uint8_t* dis_buf = s->dis_buf[tid];
     asg_t *sg = s->sg;
     hc_linkeage* t = NULL;
-    uint32_t n_vtx = sg->n_seq<<1, v, u, k, j;
+    uint32_t v, u, k, j;
     uint64_t d[2], db[2], q_u, min, min_i, min_b, rev[2], min_rev;
 
     if (sg->seq[i].del) return;
@@ -3906,11 +4161,10 @@ static void worker_for_dis(void *data, long i, int tid)
         for (v = ((uint64_t)(i)<<1); v < ((uint64_t)(i+1)<<1); v++)///two directions
         {
             d[0] = d[1] = db[0] = db[1] = (uint64_t)-1;            
-            for (j = 0; j < M->matrix.a[v].a.n; j++)
+            for (j = 0; j < 2; j++)
             {
-                q_u = M->matrix.a[v].a.a[j] >> M->uID_shift;
-                if((q_u>>1) == u) d[q_u&1] = (M->matrix.a[v].a.a[j] & M->dis_mode) + sg->seq[q_u>>1].len;
-                if((q_u>>1) > u) break;///just for speeding up, doesn't affect results
+                q_u = get_MT_dis(M, &(M->matrix.a[v]), (u<<1)+j);
+                if(q_u != (uint64_t)-1) d[j] = q_u + sg->seq[u].len;
             }
 
             min = min_i = min_b = (uint64_t)-1;
@@ -3941,10 +4195,8 @@ static void worker_for_dis(void *data, long i, int tid)
         for (v = ((uint64_t)(i)<<1); v < ((uint64_t)(i+1)<<1); v++)
         {
             d[0] = d[1] = db[0] = db[1] = (uint64_t)-1;  
-            db[0] = get_LCA(v, sg->seq[v>>1].len, u<<1, sg->seq[u].len, 
-                                                        dis_buf, n_vtx, M, bub, &rev[0]);
-            db[1] = get_LCA(v, sg->seq[v>>1].len, (u<<1) + 1, sg->seq[u].len, 
-                                                        dis_buf, n_vtx, M, bub, &rev[1]);
+            db[0] = get_LCA(v, sg->seq[v>>1].len, u<<1, sg->seq[u].len, M, bub, &rev[0]);
+            db[1] = get_LCA(v, sg->seq[v>>1].len, (u<<1) + 1, sg->seq[u].len, M, bub, &rev[1]);
 
             min = min_i = min_b = min_rev = (uint64_t)-1;
             if(t->e.a[k].dis != (uint64_t)-1) min = t->e.a[k].dis >> 3;
@@ -3968,23 +4220,9 @@ static void worker_for_dis(void *data, long i, int tid)
 void fill_utg_distance_multi(asg_t *sg, hc_links* link, MT* M, bubble_type* bub)
 {
     // double index_time = yak_realtime();
-    uint32_t i;
     utg_d_t s;
     s.sg = sg; s.link = link; s.M = M; s.bub = bub;
-    s.dis_buf = (uint8_t**)malloc(sizeof(uint8_t*)*asm_opt.thread_num);
-    for (i = 0; i < (uint32_t)asm_opt.thread_num; i++)
-    {
-        s.dis_buf[i] = (uint8_t*)malloc(sizeof(uint8_t)*(s.sg->n_seq<<1));
-    }
-    
     kt_for(asm_opt.thread_num, worker_for_dis, &s, s.sg->n_seq);
-
-
-    for (i = 0; i < (uint32_t)asm_opt.thread_num; i++)
-    {
-        free(s.dis_buf[i]);
-    }
-    free(s.dis_buf);
     // fprintf(stderr, "[M::%s::%.3f]\n", __func__, yak_realtime()-index_time);
 }
 
@@ -5168,13 +5406,15 @@ void collect_hc_reverse_links(hc_links* link, ma_ug_t* ug, bubble_type* bub)
     
 }
 
-void write_hc_links(hc_links* link, const char *fn)
+void write_hc_links(hc_links* link, ma_ug_t* ug, const char *fn)
 {
-    uint64_t k;
+    uint64_t k, hd[2];
     char *buf = (char*)calloc(strlen(fn) + 25, 1);
 	sprintf(buf, "%s.hic.link.bin", fn);
     FILE* fp = fopen(buf, "w");
 
+    hd[0] = HC_LINK_MA; hd[1] = ma_ug_hash(ug);
+    fwrite(hd, sizeof(hd[0]), 2, fp);
     fwrite(&link->a.n, sizeof(link->a.n), 1, fp);
     for (k = 0; k < link->a.n; k++)
     {
@@ -5193,9 +5433,9 @@ void write_hc_links(hc_links* link, const char *fn)
     fprintf(stderr, "[M::%s::] ==> Hi-C linkages have been written\n", __func__);
 }
 
-int load_hc_links(hc_links* link, const char *fn)
+int load_hc_links(hc_links* link, ma_ug_t* ug, const char *fn)
 {
-    uint64_t k, flag = 0;
+    uint64_t k, flag = 0, hd[2];
     char *buf = (char*)calloc(strlen(fn) + 25, 1);
 	sprintf(buf, "%s.hic.link.bin", fn);
 
@@ -5207,6 +5447,13 @@ int load_hc_links(hc_links* link, const char *fn)
         return 0;
     } 
     
+    if(fread(hd, sizeof(hd[0]), 2, fp) != 2 || hd[0] != HC_LINK_MA || hd[1] != ma_ug_hash(ug))
+    {
+        fclose(fp);
+        free(buf);
+        fprintf(stderr, "[M::%s::] ==> Renew Hi-C linkages\n", __func__);
+        return 0;
+    }
 
     kv_init(link->a);
     flag += fread(&link->a.n, sizeof(link->a.n), 1, fp);
@@ -5233,18 +5480,152 @@ int load_hc_links(hc_links* link, const char *fn)
     return 1;
 }
 
-void write_hc_hits(kvec_pe_hit* hits, ma_ug_t* ug, const char *fn)
+#define hc_zz(x) (((x)<<1)^(uint64_t)(((int64_t)(x))>>63))
+#define hc_unzz(x) (((x)>>1)^(-((x)&1)))
+
+static inline uint8_t *hc_put_var(uint8_t *p, uint64_t x)
+{
+    while (x >= 0x80) *p++ = (uint8_t)(x|0x80), x >>= 7;
+    *p++ = (uint8_t)x;
+    return p;
+}
+
+static inline const uint8_t *hc_get_var(const uint8_t *p, const uint8_t *e, uint64_t *x)
+{
+    uint64_t v = 0; uint32_t sh = 0;
+    while (p < e && sh < 64)
+    {
+        v |= (uint64_t)((*p)&0x7f)<<sh; sh += 7;
+        if(!((*p++)&0x80)) return (*x) = v, p;
+    }
+    return NULL;
+}
+
+///*.hic.lk.bin: HC_LK_MA, ma_ug_hash(), number of hits, then blocks of at most HC_LK_BLK hits;
+///within a block, s, e and id are varint-coded deltas to the previous hit and len is coded as is
+typedef struct {
+    FILE *fp;
+    uint64_t n, n_b, ps, pe, pid;
+    uint8_t *b, *p;
+} hc_lk_writer_t;
+
+static int hc_lk_open(hc_lk_writer_t *w, ma_ug_t* ug, const char *fn)
 {
     char *buf = (char*)calloc(strlen(fn) + 25, 1);
+    uint64_t hd[3];
     sprintf(buf, "%s.hic.lk.bin", fn);
-    FILE* fp = fopen(buf, "w");
+    memset(w, 0, sizeof(*w));
+    w->fp = fopen(buf, "w"); free(buf);
+    if(!w->fp) return 0;
+    MALLOC(w->b, HC_LK_BLK*40); w->p = w->b;
+    hd[0] = HC_LK_MA; hd[1] = ma_ug_hash(ug); hd[2] = 0;///number of hits is filled in by hc_lk_close()
+    fwrite(hd, sizeof(hd[0]), 3, w->fp);
+    return 1;
+}
+
+static void hc_lk_flush(hc_lk_writer_t *w)
+{
+    uint64_t hd[2];
+    if(w->n_b == 0) return;
+    hd[0] = w->n_b; hd[1] = w->p - w->b;
+    fwrite(hd, sizeof(hd[0]), 2, w->fp);
+    fwrite(w->b, 1, w->p - w->b, w->fp);
+    w->n_b = 0; w->p = w->b; w->ps = w->pe = w->pid = 0;
+}
 
-    fwrite(&hits->a.n, sizeof(hits->a.n), 1, fp);
-    fwrite(hits->a.a, sizeof(pe_hit), hits->a.n, fp);
-    write_dbug(ug, fp);
+static inline void hc_lk_push(hc_lk_writer_t *w, const pe_hit *h)
+{
+    w->p = hc_put_var(w->p, hc_zz(h->s - w->ps)); w->ps = h->s;
+    w->p = hc_put_var(w->p, hc_zz(h->e - w->pe)); w->pe = h->e;
+    w->p = hc_put_var(w->p, hc_zz(h->id - w->pid)); w->pid = h->id;
+    w->p = hc_put_var(w->p, h->len);
+    w->n++;
+    if(++w->n_b == HC_LK_BLK) hc_lk_flush(w);
+}
 
-    fclose(fp);
-    free(buf);
+static void hc_lk_close(hc_lk_writer_t *w)
+{
+    hc_lk_flush(w);
+    fseek(w->fp, sizeof(uint64_t)*2, SEEK_SET);
+    fwrite(&(w->n), sizeof(w->n), 1, w->fp);
+    fclose(w->fp); free(w->b);
+    memset(w, 0, sizeof(*w));
+}
+
+void write_hc_hits(kvec_pe_hit* hits, ma_ug_t* ug, const char *fn)
+{
+    hc_lk_writer_t w; uint64_t i;
+    if(!hc_lk_open(&w, ug, fn)) return;
+    for (i = 0; i < hits->a.n; i++) hc_lk_push(&w, &(hits->a.a[i]));
+    hc_lk_close(&w);
+}
+
+///k-way merge of the spilled runs straight into *.hic.lk.bin; duplicated (s, e) across runs are dropped;
+///only one buffer of HC_MERGE_BUF hits per run is in memory
+static uint64_t merge_spilled_hits(sldat_t *p, ma_ug_t* ug, const char *out_fn)
+{
+    double index_time = yak_realtime();
+    char *fn = (char*)malloc(strlen(asm_opt.output_file_name)+50);
+    uint64_t k, m, n_spill; hc_run_t *r; pe_hit *x, last; hc_lk_writer_t w;
+    memset(&last, 0, sizeof(last));
+    if(p->hits.a.n) spill_hits(p);
+    kv_destroy(p->hits.a); kv_init(p->hits.a);
+    if(!hc_lk_open(&w, ug, out_fn)) {
+        fprintf(stderr, "[ERROR::%s] cannot write %s.hic.lk.bin\n", __func__, out_fn);
+        exit(1);
+    }
+    CALLOC(r, p->n_spill);
+    for (k = 0; k < p->n_spill; k++) {
+        get_spill_name(fn, k);
+        r[k].fp = fopen(fn, "rb");
+        if(!r[k].fp || fread(&(r[k].n_left), sizeof(r[k].n_left), 1, r[k].fp) != 1) {
+            fprintf(stderr, "[ERROR::%s] cannot read %s\n", __func__, fn);
+            exit(1);
+        }
+        MALLOC(r[k].a, HC_MERGE_BUF);
+    }
+    while (1) {
+        for (k = 0, m = (uint64_t)-1; k < p->n_spill; k++) {
+            if(!hc_run_next(&r[k])) continue;
+            x = &(r[k].a[r[k].i]);
+            if(m == (uint64_t)-1 || x->s < r[m].a[r[m].i].s || (x->s == r[m].a[r[m].i].s && x->e < r[m].a[r[m].i].e)) m = k;
+        }
+        if(m == (uint64_t)-1) break;
+        x = &(r[m].a[r[m].i++]);
+        if(w.n > 0 && last.s == x->s && last.e == x->e) continue;
+        hc_lk_push(&w, x); last = *x;
+    }
+    for (k = 0; k < p->n_spill; k++) {
+        fclose(r[k].fp); free(r[k].a);
+        get_spill_name(fn, k);
+        remove(fn);
+    }
+    m = w.n; n_spill = p->n_spill;
+    hc_lk_close(&w); free(r); free(fn);
+    fprintf(stderr, "[M::%s::%.3f] ==> merged %lu runs, %lu hits\n", __func__, yak_realtime()-index_time, 
+                                        (unsigned long)n_spill, (unsigned long)m);
+    p->n_spill = 0;
+    return m;
+}
+
+int alignment_worker_pipeline(sldat_t* sl, const enzyme *fn1, const enzyme *fn2);
+int load_hc_hits(kvec_pe_hit* hits, ma_ug_t* ug, const char *fn);
+
+///map the Hi-C pairs and write *.hic.lk.bin; if hits were spilled, the runs are merged into the file, and the 
+///hits are loaded back only after the k-mer tables of the unitig index, which are not used after mapping, are released
+void hc_map_hits(sldat_t *sl, const enzyme *fn1, const enzyme *fn2, ma_ug_t* ug, const char *fn)
+{
+    alignment_worker_pipeline(sl, fn1, fn2);
+    if(!sl->n_spill) {
+        write_hc_hits(&(sl->hits), ug, fn);
+        return;
+    }
+    merge_spilled_hits(sl, ug, fn);
+    destory_hc_pt_index((ha_ug_index*)sl->idx);
+    if(!load_hc_hits(&(sl->hits), ug, fn)) {
+        fprintf(stderr, "[ERROR::%s] cannot reload %s.hic.lk.bin\n", __func__, fn);
+        exit(1);
+    }
 }
 
 void write_hc_hits_v14(kvec_pe_hit_hap* i_hits, const char *fn)
@@ -5398,9 +5779,11 @@ void debug_hc_hits_v14(kvec_pe_hit_hap* i_hits, const char *fn, const ha_ug_inde
 
 int load_hc_hits(kvec_pe_hit* hits, ma_ug_t* ug, const char *fn)
 {
-    uint64_t flag = 0;
     char *buf = (char*)calloc(strlen(fn) + 25, 1);
     sprintf(buf, "%s.hic.lk.bin", fn);
+    uint64_t i, k, n, hd[3], x;
+    uint8_t *b = NULL; const uint8_t *p, *e;
+    pe_hit *h = NULL;
 
     FILE* fp = NULL; 
     fp = fopen(buf, "r"); 
@@ -5409,26 +5792,41 @@ int load_hc_hits(kvec_pe_hit* hits, ma_ug_t* ug, const char *fn)
         free(buf);
         return 0;
     }
-    
-
-    kv_init(hits->a);
-    flag += fread(&hits->a.n, sizeof(hits->a.n), 1, fp);
-    hits->a.m = hits->a.n; MALLOC(hits->a.a, hits->a.n);
-    flag += fread(hits->a.a, sizeof(pe_hit), hits->a.n, fp);
     free(buf);
 
-    if(!test_dbug(ug, fp))
+    kv_init(hits->a);
+    if(fread(hd, sizeof(hd[0]), 3, fp) != 3 || hd[0] != HC_LK_MA || hd[1] != ma_ug_hash(ug)) goto renew;
+    hits->a.n = hits->a.m = hd[2]; MALLOC(hits->a.a, hits->a.n);
+    MALLOC(b, HC_LK_BLK*40);
+    for (i = 0; i < hits->a.n; i += n)
     {
-        free(hits->a.a);
-        kv_init(hits->a);
-        fclose(fp);
-        fprintf(stderr, "[M::%s::] ==> Renew Hi-C linkages\n", __func__);
-        return 0;
+        if(fread(hd, sizeof(hd[0]), 2, fp) != 2) goto renew;
+        n = hd[0];
+        if(n == 0 || n > HC_LK_BLK || i + n > hits->a.n || hd[1] > HC_LK_BLK*40) goto renew;
+        if(fread(b, 1, hd[1], fp) != hd[1]) goto renew;
+        for (k = 0, p = b, e = b + hd[1], h = hits->a.a + i; k < n; k++, h++)
+        {
+            if(!(p = hc_get_var(p, e, &x))) goto renew;
+            h->s = (k? (h-1)->s : 0) + hc_unzz(x);
+            if(!(p = hc_get_var(p, e, &x))) goto renew;
+            h->e = (k? (h-1)->e : 0) + hc_unzz(x);
+            if(!(p = hc_get_var(p, e, &x))) goto renew;
+            h->id = (k? (h-1)->id : 0) + hc_unzz(x);
+            if(!(p = hc_get_var(p, e, &x))) goto renew;
+            h->len = x;
+        }
     }
 
-    fclose(fp);
+    fclose(fp); free(b);
     fprintf(stderr, "[M::%s::] ==> Hi-C linkages have been loaded\n", __func__);
     return 1;
+
+    renew:
+    free(hits->a.a); free(b);
+    kv_init(hits->a);
+    fclose(fp);
+    fprintf(stderr, "[M::%s::] ==> Renew Hi-C linkages\n", __func__);
+    return 0;
 }
 
 inline int get_phase_status(H_partition* hap, uint32_t uID)
@@ -5538,6 +5936,7 @@ void init_min_cut_t(min_cut_t* x, hc_links* link, const bubble_type* bub, const
     ///uresolved BUGs, if use kv_resize segfault; if use kv_malloc, work?????
     kv_malloc(x->rGraph, utg_num); x->rGraph.n = utg_num;
     // kv_init(x->rGraph); kv_resize(hc_edge_warp, x->rGraph, utg_num); x->rGraph.n = utg_num;
+    kv_init(x->level); kv_init(x->iter); kv_init(x->rIdx);
     x->enzymes = link->enzymes.a;
     init_pdq(&(x->pq), utg_num<<1);
 
@@ -5619,15 +6018,18 @@ void init_min_cut_t(min_cut_t* x, hc_links* link, const bubble_type* bub, const
 
 void destory_min_cut_t(min_cut_t* x)
 {
+    uint64_t i;
     kv_destroy(x->order);
     kv_destroy(x->parent);
     kv_destroy(x->p_weight);
+    kv_destroy(x->level); kv_destroy(x->iter);
+    for (i = 0; i < x->rIdx.m; i++) kv_destroy(x->rIdx.a[i]);
+    kv_destroy(x->rIdx);
     kv_destroy(x->rGraphSet);
     kv_destroy(x->rGraphVis);
     kv_destroy(x->utgVis);
     kv_destroy(x->bmerVis);
     destory_pdq(&(x->pq));
-    uint64_t i;
     for (i = 0; i < x->rGraph.m; i++)
     {
         kv_destroy(x->rGraph.a[i]);
@@ -5760,42 +6162,139 @@ uint64_t bfs_flow(uint64_t src, uint64_t dest, min_cut_t* x, kvec_t_u64_warp* bu
     return 0;
 }
 
-uint64_t maxFlow(uint64_t src, uint64_t dest, min_cut_t* x)
+///reverse edge of rGraph.a[v].a[i]; the index is cached in rIdx and re-checked on use, 
+///since the fake node made by add_mul_convex() and the deleted edges change between cuts
+inline hc_edge* get_rGraph_rev(min_cut_t* x, uint64_t v, uint64_t i)
 {
-    double flow = 0, max_flow = 0;
-    uint64_t v, u;
-    hc_edge *p;
+    asg32_v *r = &(x->rIdx.a[v]);
+    uint64_t u = x->rGraph.a[v].a[i].uID, k, l = r->m;
+    hc_edge_warp *e = &(x->rGraph.a[u]);
+    if(r->m < x->rGraph.a[v].n)
+    {
+        kv_resize(uint32_t, *r, x->rGraph.a[v].n);
+        for (k = l; k < r->m; k++) r->a[k] = (uint32_t)-1;
+    }
+    k = r->a[i];
+    if(k < e->n && e->a[k].uID == v && !e->a[k].del) return &(e->a[k]);
+    for (k = 0; k < e->n; k++)
+    {
+        if(e->a[k].del) continue;
+        if(e->a[k].uID == v) break;
+    }
+    if(k >= e->n) return NULL;
+    r->a[i] = k;
+    return &(e->a[k]);
+}
+
+///build the level graph from src; rGraphVis is set to the nodes reachable from src, 
+///so after the last (failed) round it gives the source side of the min cut
+uint64_t bfs_level(uint64_t src, uint64_t dest, min_cut_t* x)
+{
+    uint64_t *p = NULL, v, u, i;
+    memset(x->rGraphVis.a, 0, x->rGraphVis.n);
+    kdq_clear(x->q);
+    kdq_push(uint64_t, x->q, src); 
+    x->rGraphVis.a[src] = 1; x->level.a[src] = 0;
 
-    while (bfs_flow(src, dest, x, NULL))
+    while (1)
     {
-        kdq_clear(x->q);
-        flow = DBL_MAX;
-        for (v = dest; v != src; v = x->parent.a[v])
+        p = kdq_shift(uint64_t, x->q);
+        if(!p) break;
+        v = *p;
+        x->iter.a[v] = 0;
+        for (i = 0; i < x->rGraph.a[v].n; i++)
         {
-            flow = MIN(flow, x->p_weight.a[v]);
+            if(x->rGraph.a[v].a[i].del) continue;
+            if(x->rGraph.a[v].a[i].weight <= 0) continue;
+            u = x->rGraph.a[v].a[i].uID;
+            if(x->rGraphVis.a[u]) continue;
+            if(!x->bmerVis.a[u]) continue;
+            x->level.a[u] = x->level.a[v] + 1;
+            kdq_push(uint64_t, x->q, u); 
+            x->rGraphVis.a[u] = 1;
         }
+    }
 
-        /*******************************for debug************************************/
-        // if(src == 26818) fprintf(stderr, "***********flow: %f*********\n", flow);
-        /*******************************for debug************************************/
+    return x->rGraphVis.a[dest];
+}
 
-        for (v = dest; v != src; v = x->parent.a[v])
+///Dinic's algorithm: augment a blocking flow on each level graph with current-arc pointers;
+///only reached through clean_hap(), whose one call in hic_short_align() follows its return, so it is not run
+uint64_t maxFlow(uint64_t src, uint64_t dest, min_cut_t* x)
+{
+    double flow = 0, max_flow = 0;
+    uint64_t v, u, i, top, k, dl, rn = x->rGraph.n;
+    hc_edge *e, *p;
+    if(src >= rn || dest >= rn || src == dest) return 0;
+
+    if(x->level.m < rn) kv_resize(uint32_t, x->level, rn);
+    if(x->iter.m < rn) kv_resize(uint32_t, x->iter, rn);
+    if(x->parent.m < rn) kv_resize(uint32_t, x->parent, rn);
+    x->level.n = x->iter.n = rn;
+    if(x->rIdx.m < rn)
+    {
+        k = x->rIdx.m; kv_resize(asg32_v, x->rIdx, rn);
+        for (; k < x->rIdx.m; k++) kv_init(x->rIdx.a[k]);
+    }
+    x->rIdx.n = rn;
+
+    while (bfs_level(src, dest, x))
+    {
+        dl = x->level.a[dest];
+        v = src; top = 0;
+        while (1)
         {
-            u = x->parent.a[v];
-            p = get_rGraph_edge(x, u, v);
+            if(v == dest)
+            {
+                ///x->parent keeps the nodes of the current path
+                flow = DBL_MAX;
+                for (k = 0; k < top; k++)
+                {
+                    u = x->parent.a[k];
+                    flow = MIN(flow, x->rGraph.a[u].a[x->iter.a[u]].weight);
+                }
+                for (k = 0; k < top; k++)
+                {
+                    u = x->parent.a[k];
+                    e = &(x->rGraph.a[u].a[x->iter.a[u]]);
+                    p = get_rGraph_rev(x, u, x->iter.a[u]);
+                    e->weight -= flow;
+                    p->weight += flow;
+                    x->rGraphSet.a[u] = x->rGraphSet.a[e->uID] = 1;
+                }
+                max_flow += flow;
+                v = src; top = 0;
+                continue;
+            }
 
-            /*******************************for debug************************************/
-            // if(src == 26818) fprintf(stderr, "utg%.6lul (%f)\n", u+1, p->weight);
-            /*******************************for debug************************************/
+            for (i = x->iter.a[v]; i < x->rGraph.a[v].n; i++)
+            {
+                e = &(x->rGraph.a[v].a[i]);
+                if(e->del || e->weight <= 0) continue;
+                u = e->uID;
+                if(!x->rGraphVis.a[u] || !x->bmerVis.a[u]) continue;
+                if(x->level.a[u] != x->level.a[v] + 1) continue;
+                if(u != dest && x->level.a[u] >= dl) continue;
+                break;
+            }
+            x->iter.a[v] = i;
 
-            p->weight -= flow;
-            p = get_rGraph_edge(x, v, u);
-            p->weight += flow;
-            x->rGraphSet.a[u] = x->rGraphSet.a[v] = 1;
+            if(i < x->rGraph.a[v].n)
+            {
+                x->parent.a[top++] = v;
+                v = x->rGraph.a[v].a[i].uID;
+            }
+            else
+            {
+                ///dead end; retreat and skip the arc leading here
+                x->level.a[v] = (uint32_t)-1;
+                if(top == 0) break;
+                v = x->parent.a[--top];
+                x->iter.a[v]++;
+            }
         }
-
-        max_flow += flow;
     }
+    kdq_clear(x->q);
     
     return (max_flow != 0);
 }
@@ -15266,24 +15765,34 @@ int alignment_worker_pipeline(sldat_t* sl, const enzyme *fn1, const enzyme *fn2)
 {
     double index_time = yak_realtime();
     int i;
+    sl->n_io = asm_opt.hic_io_thread; sl->n_spill = 0;
+    sl->spill_max = asm_opt.hic_hit_mem / sizeof(pe_hit);
+    memset(sl->mb, 0, sizeof(sl->mb));
+    hc_flt_gen((ha_ug_index*)sl->idx, sl->n_thread>0?sl->n_thread:1);
     for (i = 0; i < fn1->n && i < fn2->n; i++)
     {
         gzFile fp1, fp2;
-        if ((fp1 = gzopen(fn1->a[i], "r")) == 0) return 0;
-        if ((fp2 = gzopen(fn2->a[i], "r")) == 0) return 0;
+        if ((fp1 = gzopen(fn1->a[i], "r")) == 0) return hc_flt_destroy((ha_ug_index*)sl->idx), 0;
+        if ((fp2 = gzopen(fn2->a[i], "r")) == 0) return hc_flt_destroy((ha_ug_index*)sl->idx), 0;
         sl->ks1 = kseq_init(fp1);
         sl->ks2 = kseq_init(fp2);
+        sl->mb[0].ks = sl->ks1; sl->mb[1].ks = sl->ks2;
+        sl->n_pair_b = sl->is_eof = 0;
 
-        kt_pipeline(3, worker_pipeline, sl, 3);
+        kt_pipeline(asm_opt.hic_pipe_depth, worker_pipeline, sl, 3);
         
         kseq_destroy(sl->ks1);
         kseq_destroy(sl->ks2);
         gzclose(fp1);
         gzclose(fp2);
     }
+    for (i = 0; i < 2; i++) {
+        kv_destroy(sl->mb[i].off); kv_destroy(sl->mb[i].s);
+    }
+    hc_flt_destroy((ha_ug_index*)sl->idx);
     fprintf(stderr, "[M::%s::%.3f] ==> Qualification\n", __func__, yak_realtime()-index_time);
 
-    dedup_hits(&(sl->hits), 1);    
+    if(!sl->n_spill) dedup_hits(&(sl->hits), 1);///otherwise merged by hc_map_hits()
     return 1;
 }
 
@@ -15331,14 +15840,13 @@ void idx_hc_links(kvec_pe_hit* hits, ha_ug_index* idx, bubble_type* bub)
     hits->occ.n = idx->ug->g->n_seq;
     memset(hits->occ.a, 0, hits->occ.n*sizeof(uint64_t));
 
-    radix_sort_pe_hit_idx_an1(hits->a.a, hits->a.a + hits->a.n);
+    radix_sort_mt_pe_hit_idx_an1(hits->a.a, hits->a.a + hits->a.n, asm_opt.thread_num>0?asm_opt.thread_num:1);
+    grp_sort_pe_hit(hits->a.a, hits->a.n, 1, 64 - idx->uID_bits, 0, 1, asm_opt.thread_num>0?asm_opt.thread_num:1);
     for (k = 1, l = 0; k <= hits->a.n; ++k) 
     {   
         if (k == hits->a.n || 
             ((hits->a.a[k].s<<1)>>(64 - idx->uID_bits)) != ((hits->a.a[l].s<<1)>>(64 - idx->uID_bits))) 
         {
-            if (k - l > 1) radix_sort_pe_hit_idx_an2(hits->a.a + l, hits->a.a + k);
-            
             hits->idx.a[((hits->a.a[l].s<<1)>>(64 - idx->uID_bits))] 
                                                 = (uint64_t)l << 32 | (k - l);
 
@@ -17019,7 +17527,7 @@ int hic_short_align(const enzyme *fn1, const enzyme *fn2, ha_ug_index* idx, ug_o
     sldat_t sl;
     sl.idx = idx;
     sl.t_ch = idx->t_ch;
-    sl.chunk_size = 20000000;
+    sl.chunk_size = asm_opt.hic_batch;
     sl.n_thread = asm_opt.thread_num;
     sl.total_base = sl.total_pair = 0;
     idx->hap_cnt = asm_opt.hap_occ;
@@ -17028,8 +17536,7 @@ int hic_short_align(const enzyme *fn1, const enzyme *fn2, ha_ug_index* idx, ug_o
 
     if(!load_hc_hits(&sl.hits, idx->ug, asm_opt.output_file_name))
     {
-        alignment_worker_pipeline(&sl, fn1, fn2);
-        write_hc_hits(&sl.hits, idx->ug, asm_opt.output_file_name);
+        hc_map_hits(&sl, fn1, fn2, idx->ug, asm_opt.output_file_name);
     }
     sl.hits.uID_bits = idx->uID_bits; sl.hits.pos_mode = idx->pos_mode;
 
@@ -17245,7 +17752,7 @@ spg_t *hic_short_pre_align(const enzyme *fn1, const enzyme *fn2, ha_ug_index* id
     sldat_t sl;
     sl.idx = idx;
     sl.t_ch = idx->t_ch;
-    sl.chunk_size = 20000000;
+    sl.chunk_size = asm_opt.hic_batch;
     sl.n_thread = asm_opt.thread_num;
     sl.total_base = sl.total_pair = 0;
     idx->hap_cnt = asm_opt.hap_occ;
@@ -17253,9 +17760,8 @@ spg_t *hic_short_pre_align(const enzyme *fn1, const enzyme *fn2, ha_ug_index* id
 
     if(!load_hc_hits(&sl.hits, idx->ug, asm_opt.output_file_name))
     {
-        alignment_worker_pipeline(&sl, fn1, fn2);
         fprintf(stderr, "sb0sb\n");
-        write_hc_hits(&sl.hits, idx->ug, asm_opt.output_file_name);
+        hc_map_hits(&sl, fn1, fn2, idx->ug, asm_opt.output_file_name);
         fprintf(stderr, "sb1sb\n");
     }
     sl.hits.uID_bits = idx->uID_bits; sl.hits.pos_mode = idx->pos_mode;
@@ -17344,7 +17850,7 @@ int hic_short_align_poy(const enzyme *fn1, const enzyme *fn2, ha_ug_index* idx,
     kv_init(back_hc_edge.a);
     sl.idx = idx;
     sl.t_ch = idx->t_ch;
-    sl.chunk_size = 20000000;
+    sl.chunk_size = asm_opt.hic_batch;
     sl.n_thread = asm_opt.thread_num;
     sl.total_base = sl.total_pair = 0;
     idx->hap_cnt = asm_opt.hap_occ;
@@ -17353,8 +17859,7 @@ int hic_short_align_poy(const enzyme *fn1, const enzyme *fn2, ha_ug_index* idx,
     
     if(!load_hc_hits(&sl.hits, idx->ug, asm_opt.output_file_name))
     {
-        alignment_worker_pipeline(&sl, fn1, fn2);
-        write_hc_hits(&sl.hits, idx->ug, asm_opt.output_file_name);
+        hc_map_hits(&sl, fn1, fn2, idx->ug, asm_opt.output_file_name);
     }
 
     hc_links link;
@@ -17660,7 +18165,7 @@ int hic_short_align_mmhap(const enzyme *fn1, const enzyme *fn2, ha_ug_index* idx
     sldat_t sl; 
     sl.idx = idx;
     sl.t_ch = idx->t_ch;
-    sl.chunk_size = 20000000;
+    sl.chunk_size = asm_opt.hic_batch;
     sl.n_thread = asm_opt.thread_num;
     sl.total_base = sl.total_pair = 0;
     idx->hap_cnt = asm_opt.hap_occ;
@@ -17668,8 +18173,7 @@ int hic_short_align_mmhap(const enzyme *fn1, const enzyme *fn2, ha_ug_index* idx
 
 
     if(!load_hc_hits(&sl.hits, idx->ug, asm_opt.output_file_name)) {
-        alignment_worker_pipeline(&sl, fn1, fn2);
-        write_hc_hits(&sl.hits, idx->ug, asm_opt.output_file_name);
+        hc_map_hits(&sl, fn1, fn2, idx->ug, asm_opt.output_file_name);
     }
     sl.hits.uID_bits = idx->uID_bits; sl.hits.pos_mode = idx->pos_mode;
 
@@ -17706,11 +18210,14 @@ int hic_short_align_mmhap(const enzyme *fn1, const enzyme *fn2, ha_ug_index* idx
 void hic_analysis(ma_ug_t *ug, asg_t* read_g, trans_chain* t_ch, ug_opt_t *opt, mmhap_t **rh, kvec_pe_hit **rhits)
 {
     ug_index = NULL;
+    ///keep unitig sequences 2-bit packed while the index and the Hi-C hits are in memory
+    ma_ug_pseq_t *ps = ma_ug_pseq_gen(ug, 1);
     int exist = (asm_opt.load_index_from_disk? 
                     load_hc_pt_index(&ug_index, ug, asm_opt.output_file_name) : 0);
-    if(exist == 0) ug_index = build_unitig_index(ug, asm_opt.hic_mer_length, asm_opt.hap_occ, 0, asm_opt.thread_num);
+    if(exist == 0) ug_index = build_unitig_index(ug, ps, asm_opt.hic_mer_length, asm_opt.hap_occ, 0, asm_opt.thread_num);
     if(exist == 0) write_hc_pt_index(ug_index, asm_opt.output_file_name);
     ug_index->ug = ug;
+    ug_index->ps = ps;
     ug_index->read_g = read_g;
     ug_index->t_ch = t_ch;
     ///test_unitig_index(ug_index, ug);
@@ -17720,6 +18227,7 @@ void hic_analysis(ma_ug_t *ug, asg_t* read_g, trans_chain* t_ch, ug_opt_t *opt,
     
     
     destory_hc_pt_index(ug_index);free(ug_index);
+    ma_ug_pseq_restore(ug, ps); ma_ug_pseq_destroy(ps);
 }
 
 uint64_t ug_occ_hap_w(uint64_t is, uint64_t ie, ma_utg_t *u)
@@ -17911,7 +18419,7 @@ spg_t *hic_pre_analysis(ma_ug_t *ug, asg_t* read_g, trans_chain* t_ch, ug_opt_t
     ug_index = NULL;
     int exist = (asm_opt.load_index_from_disk? 
                     load_hc_pt_index(&ug_index, ug, asm_opt.output_file_name) : 0);
-    if(exist == 0) ug_index = build_unitig_index(ug, asm_opt.hic_mer_length, asm_opt.hap_occ, 0, asm_opt.thread_num);
+    if(exist == 0) ug_index = build_unitig_index(ug, NULL, asm_opt.hic_mer_length, asm_opt.hap_occ, 0, asm_opt.thread_num);
     if(exist == 0) write_hc_pt_index(ug_index, asm_opt.output_file_name);
     ug_index->ug = ug;
     ug_index->read_g = read_g;
@@ -17925,7 +18433,7 @@ void init_ug_idx(ma_ug_t *ug, uint64_t k, uint64_t up_bound, uint64_t low_bound,
     ug_index = NULL;
     if(build_idx)
     {
-        ug_index = build_unitig_index(ug, k, up_bound, low_bound, asm_opt.thread_num);
+        ug_index = build_unitig_index(ug, NULL, k, up_bound, low_bound, asm_opt.thread_num);
     }
 }
 
@@ -18354,7 +18862,7 @@ int hic_short_align_bench(const enzyme *fn1, const enzyme *fn2, const char *outp
     sldat_t sl;
     sl.idx = idx;
     ///sl.link = NULL;
-    sl.chunk_size = 20000000;
+    sl.chunk_size = asm_opt.hic_batch;
     sl.n_thread = asm_opt.thread_num;
     sl.total_base = sl.total_pair = 0;
     idx->hap_cnt = asm_opt.hap_occ;
@@ -18365,8 +18873,7 @@ int hic_short_align_bench(const enzyme *fn1, const enzyme *fn2, const char *outp
     {
         // kt_pipeline(3, worker_pipeline, &sl, 3);
         // dedup_hits(&sl.hits);
-        alignment_worker_pipeline(&sl, fn1, fn2);
-        write_hc_hits(&sl.hits, idx->ug, output_file_name);
+        hc_map_hits(&sl, fn1, fn2, idx->ug, output_file_name);
     }
     bench_idx bench;
     init_bench_idx(&bench, idx->read_g, idx->ug);
@@ -18385,7 +18892,7 @@ void hic_benchmark(ma_ug_t *ug, asg_t* read_g)
 	sprintf(output_file_name, "%s.bench", asm_opt.output_file_name);
     ug_index = NULL;
     int exist = load_hc_pt_index(&ug_index, ug, output_file_name);
-    if(exist == 0) ug_index = build_unitig_index(ug, asm_opt.hic_mer_length, asm_opt.hap_occ, 0, asm_opt.thread_num);
+    if(exist == 0) ug_index = build_unitig_index(ug, NULL, asm_opt.hic_mer_length, asm_opt.hap_occ, 0, asm_opt.thread_num);
     if(exist == 0) write_hc_pt_index(ug_index, output_file_name);
     ug_index->ug = ug;
     ug_index->read_g = read_g;
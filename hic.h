@@ -89,8 +89,8 @@ typedef struct{
 #define IF_HOM(ID, B) ((B).index[(ID)] > (B).f_bub+1)
 #define Get_bub_num(RECORD) ((RECORD).num.n-1)
 void get_bubbles(bubble_type* bub, uint64_t id, uint32_t* beg, uint32_t* sink, uint32_t** a, uint32_t* n, uint64_t* pathBase);
-int load_hc_links(hc_links* link, const char *fn);
-void write_hc_links(hc_links* link, const char *fn);
+int load_hc_links(hc_links* link, ma_ug_t* ug, const char *fn);
+void write_hc_links(hc_links* link, ma_ug_t* ug, const char *fn);
 void destory_bubbles(bubble_type* bub);
 void identify_bubbles(ma_ug_t* ug, bubble_type* bub, uint8_t *r_het_flag, kv_u_trans_t *ref);
 void identify_bubbles_recal(asg_t* sg, ma_ug_t* ug, bubble_type* bub, uint8_t *r_het_flag, ma_hit_t_alloc* sources, R_to_U* ruIndex,
@@ -3,6 +3,8 @@
 #include <assert.h>
 #include <zlib.h>
 #include <math.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include "kseq.h" // FASTA/Q parser
 #include "kavl.h"
 #include "khash.h"
@@ -26,10 +28,12 @@ KSORT_INIT(or_xe, overlap_region, oreg_xe_lt)
 #define u_trans_qs_key0(a) ((a).qs)
 KRADIX_SORT_INIT(u_trans_qs0, u_trans_t, u_trans_qs_key0, member_size(u_trans_t, qs))
 
-void ha_get_ul_candidates_interface(ha_abufl_t *ab, int64_t rid, char* rs, uint64_t rl, uint64_t mz_w, uint64_t mz_k, const ul_idx_t *uref, overlap_region_alloc *overlap_list, overlap_region_alloc *overlap_list_hp, Candidates_list *cl, double bw_thres, 
+void ha_get_ul_candidates_interface(ha_abufl_t *ab, int64_t rid, char* rs, uint64_t rl, uint64_t mz_w, uint64_t mz_k, const void *ha_flt_tab, const ha_pt_t *ha_idx, const ul_idx_t *uref, overlap_region_alloc *overlap_list, overlap_region_alloc *overlap_list_hp, Candidates_list *cl, double bw_thres, 
 								 int max_n_chain, int keep_whole_chain, kvec_t_u8_warp* k_flag, kvec_t_u64_warp* chain_idx, overlap_region* f_cigar, kvec_t_u64_warp* dbg_ct, st_mt_t *sp, uint32_t high_occ, void *km);
-void ul_map_lchain(ha_abufl_t *ab, uint32_t rid, char* rs, uint64_t rl, uint64_t mz_w, uint64_t mz_k, const ul_idx_t *uref, overlap_region_alloc *overlap_list, Candidates_list *cl, double bw_thres, 
+void ul_map_lchain(ha_abufl_t *ab, uint32_t rid, char* rs, uint64_t rl, uint64_t mz_w, uint64_t mz_k, const void *ha_flt_tab, const ha_pt_t *ha_idx, const ul_idx_t *uref, overlap_region_alloc *overlap_list, Candidates_list *cl, double bw_thres, 
 								 int max_n_chain, int apend_be, kvec_t_u8_warp* k_flag, overlap_region* f_cigar, kvec_t_u64_warp* dbg_ct, st_mt_t *sp, uint32_t *high_occ, uint32_t *low_occ, uint32_t is_accurate, uint32_t gen_off, double mcopy_rate, uint32_t chain_cutoff, uint32_t mcopy_khit_cut);
+void ul_sample_anchors(ha_abufl_t *ab, const char* rs, int64_t rl, uint64_t mz_w, uint64_t mz_k, const void *flt_tab, const ha_pt_t *idx, 
+st_mt_t *sp, int64_t n_seg, int64_t seg_len, uint64_t *cnt);
 int64_t ug_map_lchain(ha_abufl_t *ab, uint32_t rid, char* rs, uint64_t rl, uint64_t mz_w, uint64_t mz_k, const ul_idx_t *uref, overlap_region_alloc *overlap_list, Candidates_list *cl, double bw_thres, double bw_thres_sec,
 								 int max_n_chain, int apend_be, kvec_t_u8_warp* k_flag, overlap_region* f_cigar, kvec_t_u64_warp* dbg_ct, st_mt_t *sp, uint32_t *high_occ, uint32_t *low_occ, uint32_t is_accurate, 
 								 uint32_t gen_off, double mcopy_rate, uint32_t mcopy_khit_cut, uint32_t is_hpc, ha_mzl_t *res, uint64_t res_n, ha_mzl_t *idx, uint64_t idx_n, uint64_t mzl_cutoff, uint64_t chain_cutoff, kv_u_trans_t *kov);
@@ -221,6 +225,8 @@ typedef struct { // global data structure for kt_pipeline()
 	const ul_idx_t *uu;
 	idx_emask_t *mm;
 	ucr_file_t *ucr_s;
+	FILE *gaf;///--ul-gaf output
+	struct ul_rs_s *rs;
 	kseq_t *ks;
     int64_t chunk_size;
     uint64_t n_thread;
@@ -229,6 +235,7 @@ typedef struct { // global data structure for kt_pipeline()
 	mg_gres_a hits;
 	mg_dbn_t nn;
 	uint64_t num_bases, num_corrected_bases, num_recorrected_bases;
+	uint64_t tri_n[2], tri_b[2];///--ul-triage: # reads and # bases skipped or aligned
 } uldat_t;
 
 typedef struct {
@@ -399,6 +406,8 @@ typedef struct { // data structure for each step in kt_pipeline()
 	uint64_t num_bases, num_corrected_bases, num_recorrected_bases;
 	int64_t n_thread;
 	scaf_res_t *rsc;
+	uint8_t **gz; uint64_t *gz_n; int64_t gz_b;///compressed GAF blocks, written in order by the last step
+	uint64_t tri_n[2], tri_b[2];
 } utepdat_t;
 
 typedef struct { // global data structure for kt_pipeline()
@@ -510,30 +519,30 @@ double diff_ec_ul, double diff_ec_ul_low, double diff_ec_ul_hpc, int ec_ul_round
 	opt->diff_ec_ul_low = diff_ec_ul_low;
 	opt->diff_ec_ul_hpc = diff_ec_ul_hpc;
 	opt->ec_ul_round = ec_ul_round;
+	opt->lc_rmq = asm_opt.ul_chain;
 }
 
-void uidx_l_build(ma_ug_t *ug, mg_idxopt_t *opt, int cutoff)
+void uidx_l_build(ma_ug_t *ug, mg_idxopt_t *opt, int cutoff, void **flt_tab, ha_pt_t **idx)
 {
-    ha_flt_tab = ha_ft_ul_gen(&asm_opt, &(ug->u), opt->k, opt->w, cutoff);
-    ha_idx = ha_pt_ul_gen(&asm_opt, ha_flt_tab, &(ug->u), opt->k, opt->w, cutoff);	
+    (*flt_tab) = ha_ft_ul_gen(&asm_opt, &(ug->u), opt->k, opt->w, cutoff);
+    (*idx) = ha_pt_ul_gen(&asm_opt, (*flt_tab), &(ug->u), opt->k, opt->w, cutoff);	
 	fprintf(stderr, "[M::%s] Index has been built.\n", __func__);
 }
 
-void uidx_build(ma_ug_t *ug, mg_idxopt_t *opt)
+void uidx_build(ma_ug_t *ug, mg_idxopt_t *opt, void **flt_tab, ha_pt_t **idx)
 {
     int flag = asm_opt.flag;
     asm_opt.flag |= HA_F_NO_HPC;
-    ha_flt_tab = ha_ft_ug_gen(&asm_opt, &(ug->u), opt->is_HPC, opt->k, opt->w, 1, opt->hap_n*5);
-    ha_idx = ha_pt_ug_gen(&asm_opt, ha_flt_tab, &(ug->u), opt->is_HPC, opt->k, opt->w, 1);
+    (*flt_tab) = ha_ft_ug_gen(&asm_opt, &(ug->u), opt->is_HPC, opt->k, opt->w, 1, opt->hap_n*5);
+    (*idx) = ha_pt_ug_gen(&asm_opt, (*flt_tab), &(ug->u), opt->is_HPC, opt->k, opt->w, 1);
     asm_opt.flag = flag;
 	fprintf(stderr, "[M::%s] Index has been built.\n", __func__);
 }
 
-void uidx_destory()
+void uidx_destory(void *flt_tab, ha_pt_t *idx)
 {
-    ha_ft_destroy(ha_flt_tab); 
-    ha_pt_destroy(ha_idx);
-	ha_flt_tab = NULL; ha_idx = NULL;
+    ha_ft_destroy(flt_tab); 
+    ha_pt_destroy(idx);
 }
 
 void mg_gres_a_des(mg_gres_a *p)
@@ -877,6 +886,76 @@ mg128_t *mg_lchain_dp(int max_dist_x, int max_dist_y, int bw, int max_skip, int
 	return compact_a(km, n_u, u, n_v, v, a);
 }
 
+///same input/output as mg_lchain_dp(); the best predecessor is found by a range-maximum query
+///over active anchors keyed by q_pos, with the gap approximated by 0.5*chn_pen_gap*(dr+dq);
+///the hit is rescored by comput_sc() together with the max_skip closest predecessors
+mg128_t *mg_lchain_rmq(int max_dist_x, int max_dist_y, int bw, int max_skip, int max_iter, int min_cnt, int min_sc, float chn_pen_gap, 
+					  int64_t n, mg128_t *a, int *n_u_, uint64_t **_u, void *km)
+{
+	int32_t *f, *t, *v, n_u, n_v;
+	int64_t *p, *rk, *id, i, j, k, l, r, st, i0, sz;
+	uint32_t *qs;
+	double *sv, hw = 0.5 * chn_pen_gap;
+	mg128_t *w;
+	uint64_t *u;
+
+	if (_u) *_u = 0, *n_u_ = 0;
+	if (n == 0 || a == 0) return 0;
+	KMALLOC(km, p, n);
+	KMALLOC(km, f, n);
+	KMALLOC(km, v, n);
+	KCALLOC(km, t, n);
+
+	///rank anchors by q_pos
+	KMALLOC(km, w, n);
+	for (i = 0; i < n; ++i) w[i].x = (uint32_t)a[i].y, w[i].y = i;
+	radix_sort_128x(w, w + n);
+	KMALLOC(km, rk, n); KMALLOC(km, qs, n);
+	for (k = 0; k < n; ++k) rk[w[k].y] = k, qs[k] = w[k].x;
+	kfree(km, w);
+	for (sz = 1; sz < n; sz <<= 1);
+	KMALLOC(km, sv, sz<<1); KMALLOC(km, id, sz<<1);
+	for (k = 0; k < (sz<<1); ++k) id[k] = -1;
+
+	for (i = st = i0 = 0; i < n; ++i) {
+		int64_t max_j = -1, q = (uint32_t)a[i].y;
+		int32_t max_f = normal_sc(a[i].y>>MG_SEED_WT_SHIFT, a[i].y>>32&0xff), sc;
+		///drop anchors that are out of range
+		while (st < i && (a[i].x>>32 != a[st].x>>32 || a[i].x > a[st].x + max_dist_x)) {
+			if (st < i0) lc_rmq_set(sz, sv, id, rk[st], -1, 0);
+			++st;
+		}
+		if (i0 < st) i0 = st;
+		///activate anchors with a smaller r_pos; the ones at a[i].x cannot be predecessors
+		for (; i0 < i && a[i0].x < a[i].x; ++i0)
+			lc_rmq_set(sz, sv, id, rk[i0], i0, f[i0] + hw * ((double)(uint32_t)a[i0].x + (double)(uint32_t)a[i0].y));
+		///q_pos of predecessors in [q - max_dist_x, q - 1]
+		for (l = 0, r = n, k = q - max_dist_x; l < r; ) { j = (l + r)>>1; if ((int64_t)qs[j] < k) l = j + 1; else r = j; }
+		for (r = n, k = l; k < r; ) { j = (k + r)>>1; if ((int64_t)qs[j] < q) k = j + 1; else r = j; }
+		if (l < r && (j = lc_rmq_max(sz, sv, id, l, r)) >= 0) {
+			sc = comput_sc(&a[i], &a[j], max_dist_x, max_dist_y, bw, chn_pen_gap);
+			if (sc != INT32_MIN && sc + f[j] > max_f) max_f = sc + f[j], max_j = j;
+		}
+		///close predecessors are cheap and catch what the linear gap approximation misses
+		for (j = i - 1, k = 0; j >= st && k < max_skip; --j, ++k) {
+			sc = comput_sc(&a[i], &a[j], max_dist_x, max_dist_y, bw, chn_pen_gap);
+			if (sc != INT32_MIN && sc + f[j] > max_f) max_f = sc + f[j], max_j = j;
+		}
+		f[i] = max_f, p[i] = max_j;
+		v[i] = max_j >= 0 && v[max_j] > max_f? v[max_j] : max_f;
+	}
+	kfree(km, rk); kfree(km, qs); kfree(km, sv); kfree(km, id);
+
+	u = mg_chain_backtrack(km, n, f, p, v, t, min_cnt, min_sc, 0, &n_u, &n_v);
+	*n_u_ = n_u, *_u = u;
+	kfree(km, p); kfree(km, f); kfree(km, t);
+	if (n_u == 0) {
+		kfree(km, a); kfree(km, v);
+		return 0;
+	}
+	return compact_a(km, n_u, u, n_v, v, a);
+}
+
 
 void extend_coordinates(mg_lchain_t *ri, int64_t qlen, int64_t rlen)
 {
@@ -2270,8 +2349,13 @@ st_mt_t *sp, mg_tbuf_t *b, int32_t w, int32_t k, int32_t hpc, int32_t mz_sd, int
         if(a) kfree(b->km, a);
         a = 0, n_lc = 0, u = 0;
     } else {
-		a = mg_lchain_dp(max_chain_gap_ref, max_chain_gap_qry, opt->bw, opt->max_lc_skip, opt->max_lc_iter, 
-		opt->min_lc_cnt, opt->min_lc_score, opt->chn_pen_gap, n_a, a, &n_lc, &u, b->km);
+		if (opt->lc_rmq) {
+			a = mg_lchain_rmq(max_chain_gap_ref, max_chain_gap_qry, opt->bw, opt->max_lc_skip, opt->max_lc_iter, 
+			opt->min_lc_cnt, opt->min_lc_score, opt->chn_pen_gap, n_a, a, &n_lc, &u, b->km);
+		} else {
+			a = mg_lchain_dp(max_chain_gap_ref, max_chain_gap_qry, opt->bw, opt->max_lc_skip, opt->max_lc_iter, 
+			opt->min_lc_cnt, opt->min_lc_score, opt->chn_pen_gap, n_a, a, &n_lc, &u, b->km);
+		}
     }
 	
 	if (n_lc) {///n_lc is how many linear chain we found
@@ -4985,7 +5069,7 @@ void update_ul_vec_t_ug(const ul_idx_t *uref, ul_vec_t *rch, vec_mg_lchain_t *uc
 	///x->dist_pre is the idx of this chain at rch 
 	// debug_intermediate_chain(uref->ug, uc->a, uc->n, 1, debug_i);
 	// dd_ul_vec_t(uref, swap->a, swap->n, rch);
-	rch->bb.n = 0; kv_resize(uc_block_t, rch->bb, (uint64_t)a_n);
+	rch->bb.n = 0; ul_bb_own(rch); kv_resize(uc_block_t, rch->bb, (uint64_t)a_n);
 	for (k = 0; k < ucn; k += ix->cnt + 1) {
 		ix = &(uc->a[k]); assert(ix->v == (uint32_t)-1); ix->hash_pre = (uint32_t)-1; ix->off = -1;
 		a = uc->a + k + 1; a_n = ix->cnt;
@@ -7508,7 +7592,7 @@ static void worker_for_ul_scall_alignment_back(void *data, long i, int tid) // c
 	// fprintf(stderr, "[M::%s] rid:%ld\n", __func__, s->id+i);
 	// if (memcmp(UL_INF.nid.a[s->id+i].a, "d0aab024-b3a7-40fb-83cc-22c3d6d951f8", UL_INF.nid.a[s->id+i].n-1)) return;
 	// fprintf(stderr, "[M::%s::] ==> len: %lu\n", __func__, s->len[i]);
-	ha_get_ul_candidates_interface(b->abl, i, s->seq[i], s->len[i], s->opt->w, s->opt->k, s->uu, &b->olist, &b->olist_hp, &b->clist, s->opt->bw_thres, 
+	ha_get_ul_candidates_interface(b->abl, i, s->seq[i], s->len[i], s->opt->w, s->opt->k, s->ha_flt_tab, s->ha_idx, s->uu, &b->olist, &b->olist_hp, &b->clist, s->opt->bw_thres, 
 		s->opt->max_n_chain, 1, NULL, &b->r_buf, &(b->tmp_region), NULL, &(b->sp), asm_opt.hom_cov, km);
 	
 	clear_Cigar_record(&b->cigar1);
@@ -9217,9 +9301,9 @@ int64_t rid, ha_ovec_buf_t *bb, int64_t max_chain)
 }
 
 
-static void worker_for_ul_scall_alignment(void *data, long i, int tid) // callback for kt_for()
+///mt: align the overlaps of read i with several threads; NULL within kt_for()
+static void ul_scall_alignment(utepdat_t *s, long i, int tid, ul_aln_mt_t *mt)
 {
-    utepdat_t *s = (utepdat_t*)data;
 	ha_ovec_buf_t *b = s->hab[tid];
 	glchain_t *bl = &(s->ll[tid]);
 	int64_t /**rid = s->id+i,**/ winLen = MIN((((double)THRESHOLD_MAX_SIZE)/s->opt->diff_ec_ul), WINDOW), cha_idx;
@@ -9230,22 +9314,23 @@ static void worker_for_ul_scall_alignment(void *data, long i, int tid) // callba
     //      (int32_t)UL_INF.nid.a[s->id+i].n, UL_INF.nid.a[s->id+i].a);
 	// if (memcmp(UL_INF.nid.a[s->id+i].a, "d0aab024-b3a7-40fb-83cc-22c3d6d951f8", UL_INF.nid.a[s->id+i].n-1)) return;
 	// fprintf(stderr, "[M::%s::] ==> len: %lu\n", __func__, s->len[i]);
-	// ha_get_ul_candidates_interface(b->abl, i, s->seq[i], s->len[i], s->opt->w, s->opt->k, s->uu, &b->olist, &b->olist_hp, &b->clist, s->opt->bw_thres, 
+	// ha_get_ul_candidates_interface(b->abl, i, s->seq[i], s->len[i], s->opt->w, s->opt->k, s->ha_flt_tab, s->ha_idx, s->uu, &b->olist, &b->olist_hp, &b->clist, s->opt->bw_thres, 
 	// 	s->opt->max_n_chain, 1, NULL/**&(b->k_flag)**/, &b->r_buf, &(b->tmp_region), NULL, &(b->sp), asm_opt.hom_cov, km);
-	ul_map_lchain(b->abl, (uint32_t)-1, s->seq[i], s->len[i], s->opt->w, s->opt->k, s->uu, &b->olist, &b->clist, s->opt->bw_thres, 
+	b->clist.chainDP.is_rmq = s->opt->lc_rmq;
+	ul_map_lchain(b->abl, (uint32_t)-1, s->seq[i], s->len[i], s->opt->w, s->opt->k, s->ha_flt_tab, s->ha_idx, s->uu, &b->olist, &b->clist, s->opt->bw_thres, 
             s->opt->max_n_chain, 1, NULL, &(b->tmp_region), NULL, &(b->sp), &high_occ, NULL, 0, 1, 0.2/**0.75**/, 2, 3);
 			
 	clear_Cigar_record(&b->cigar1);
 	clear_Round2_alignment(&b->round2);
 	
 	ul_rid_lalign_adv(&b->olist, &b->clist, s->uu, s->uopt, s->seq[i], s->len[i], &b->self_read, &b->ovlp_read, 
-		&b->exz, NULL, s->opt->diff_ec_ul, winLen, NULL, NULL, NULL, s->id+i, s->opt->k, NULL);
+		&b->exz, NULL, s->opt->diff_ec_ul, winLen, NULL, NULL, NULL, s->id+i, s->opt->k, mt, NULL);
 
 	aux_o = gen_aux_ovlp(&b->olist);///must be here
 	cha_idx = bl->tk.n;
 
 	ul_rid_lalign_adv(&b->olist, &b->clist, s->uu, s->uopt, s->seq[i], s->len[i], &b->self_read, &b->ovlp_read, 
-		&b->exz, aux_o, s->opt->diff_ec_ul, winLen, &(bl->tk), &(bl->lo), &(bl->tc), s->id+i, s->opt->k, NULL);
+		&b->exz, aux_o, s->opt->diff_ec_ul, winLen, &(bl->tk), &(bl->lo), &(bl->tc), s->id+i, s->opt->k, NULL, NULL);
 
 	// bl->lo.n = bl->tk.n = 0;
 	gen_rid_raw_chain(&b->olist, bl, cha_idx, &(b->clist.chainDP), s->uu, s->opt->diff_ec_ul, s->len[i], s->uopt, s->seq[i], &b->ovlp_read, &b->exz, i, s->id+i, b, s->opt->max_n_chain);
@@ -9296,9 +9381,9 @@ static void worker_for_ul_scall_alignment(void *data, long i, int tid) // callba
 	
 // }
 
-static void worker_for_ul_rescall_alignment(void *data, long i, int tid) // callback for kt_for()
+///mt: align the overlaps of read i with several threads; NULL within kt_for()
+static void ul_rescall_alignment(utepdat_t *s, long i, int tid, ul_aln_mt_t *mt)
 {
-    utepdat_t *s = (utepdat_t*)data;
     ha_ovec_buf_t *b = s->hab[tid];
     glchain_t *bl = &(s->ll[tid]);
     int64_t /**rid = s->id+i,**/ winLen = MIN((((double)THRESHOLD_MAX_SIZE)/s->opt->diff_ec_ul), WINDOW), ton = 0;
@@ -9333,9 +9418,10 @@ static void worker_for_ul_rescall_alignment(void *data, long i, int tid) // call
 
     // if (memcmp(UL_INF.nid.a[s->id+i].a, "d0aab024-b3a7-40fb-83cc-22c3d6d951f8", UL_INF.nid.a[s->id+i].n-1)) return;
     // fprintf(stderr, "[M::%s::] ==> len: %lu\n", __func__, s->len[i]);
-    // ha_get_ul_candidates_interface(b->abl, i, s->seq[i], s->len[i], s->opt->w, s->opt->k, s->uu, &b->olist, &b->olist_hp, &b->clist, s->opt->bw_thres, 
+    // ha_get_ul_candidates_interface(b->abl, i, s->seq[i], s->len[i], s->opt->w, s->opt->k, s->ha_flt_tab, s->ha_idx, s->uu, &b->olist, &b->olist_hp, &b->clist, s->opt->bw_thres, 
     //     s->opt->max_n_chain, 1, NULL, &b->r_buf, &(b->tmp_region), NULL, &(b->sp), 1, NULL);
-    ul_map_lchain(b->abl, (uint32_t)-1, s->seq[i], s->len[i], s->opt->w, s->opt->k, s->uu, &b->olist, &b->clist, s->opt->bw_thres, 
+    b->clist.chainDP.is_rmq = s->opt->lc_rmq;
+    ul_map_lchain(b->abl, (uint32_t)-1, s->seq[i], s->len[i], s->opt->w, s->opt->k, s->ha_flt_tab, s->ha_idx, s->uu, &b->olist, &b->clist, s->opt->bw_thres, 
             s->opt->max_n_chain, 1, NULL, &(b->tmp_region), NULL, &(b->sp), &high_occ, NULL, 0, 1, 0.2, /**0**/2, 1/**3**/);
 
     clear_Cigar_record(&b->cigar1);
@@ -9350,7 +9436,7 @@ static void worker_for_ul_rescall_alignment(void *data, long i, int tid) // call
 	// memset(&b->self_read, 0, sizeof(b->self_read));
 
 	ul_lalign(&b->olist, &b->clist, s->uu, s->uopt, s->seq[i], s->len[i], &b->self_read, &b->ovlp_read,
-                        &b->correct, &b->exz, &b->hap, &b->r_buf, aux_o, s->opt->diff_ec_ul, winLen, NULL, s->id+i, s->opt->k, &(s->sps[tid]), s->mm, &(s->mk[tid]), NULL);
+                        &b->correct, &b->exz, &b->hap, &b->r_buf, aux_o, s->opt->diff_ec_ul, winLen, NULL, s->id+i, s->opt->k, &(s->sps[tid]), s->mm, &(s->mk[tid]), mt, NULL);
 	// ul_lalign_old_ed(&b->olist, &b->clist, s->uu, s->seq[i], s->len[i], &b->self_read, &b->ovlp_read,
     //                     &b->correct, &b->hap, &b->r_buf, s->opt->diff_ec_ul, winLen, 1, NULL);
 	ton = b->olist.length;//all alignments pass similary check
@@ -9369,7 +9455,7 @@ static void worker_for_ul_rescall_alignment(void *data, long i, int tid) // call
 		copy_asg_arr(b->hap.snp_srt, b0); copy_asg_arr(s->sps[tid], b1); copy_asg_arr(b->r_buf.a, b2); 
 		
 		ul_lalign(&b->olist, &b->clist, s->uu, s->uopt, s->seq[i], s->len[i], &b->self_read, &b->ovlp_read,
-						&b->correct, &b->exz, &b->hap, &b->r_buf, aux_o, s->opt->diff_ec_ul, winLen, &(bl->lo), s->id+i, s->opt->k, &(s->sps[tid]), s->mm, &(s->mk[tid]), NULL);
+						&b->correct, &b->exz, &b->hap, &b->r_buf, aux_o, s->opt->diff_ec_ul, winLen, &(bl->lo), s->id+i, s->opt->k, &(s->sps[tid]), s->mm, &(s->mk[tid]), NULL, NULL);
 		// ul_lalign_old_ed(&b->olist, &b->clist, s->uu, s->seq[i], s->len[i], &b->self_read, &b->ovlp_read,
 		//                 &b->correct, &b->hap, &b->r_buf, s->opt->diff_ec_ul, winLen, 0, NULL);
 		// fprintf(stderr, "\n[M::%s] b->olist.length::%lu, ton::%ld\n", __func__, 
@@ -12650,7 +12736,7 @@ static void worker_for_ul_recorrect_alignment(void *data, long i, int tid) // ca
     // fprintf(stderr, "\n[M::%s] rid:%ld, len:%lu\n", __func__, s->id+i, s->len[i]);
     // if (memcmp(UL_INF.nid.a[s->id+i].a, "d0aab024-b3a7-40fb-83cc-22c3d6d951f8", UL_INF.nid.a[s->id+i].n-1)) return;
     // fprintf(stderr, "[M::%s::] ==> len: %lu\n", __func__, s->len[i]);
-    ha_get_ul_candidates_interface(b->abl, i, s->seq[i], s->len[i], s->opt->w, s->opt->k, s->uu, &b->olist, &b->olist_hp, &b->clist, s->opt->bw_thres, 
+    ha_get_ul_candidates_interface(b->abl, i, s->seq[i], s->len[i], s->opt->w, s->opt->k, s->ha_flt_tab, s->ha_idx, s->uu, &b->olist, &b->olist_hp, &b->clist, s->opt->bw_thres, 
         s->opt->max_n_chain, 1, NULL/**&(b->k_flag)**/, &b->r_buf, &(b->tmp_region), NULL, &(b->sp), 1, NULL);
     
     clear_Cigar_record(&b->cigar1);
@@ -12788,6 +12874,175 @@ int64_t get_utepdat_t_mem(const utepdat_t *b, int64_t is_print)
 	return mem[0] + mem[1] + mem[2] + mem[3] + mem[4] + mem[5] + mem[6];
 }
 
+#define UL_RS_MA 0x3153522d4c55ULL ///magic of *.ul.rs.bin
+
+///packed copy of the UL reads, written by the first pass over the raw files and read by later passes;
+///a record is name length, name, read length, # N runs, N runs (beg, len) and 2-bit bases
+typedef struct ul_rs_s {
+	FILE *fp;
+	uint64_t is_rd, n, n_off;///read mode; # reads; offset of n in the header
+	kvec_t(uint8_t) b;
+	kvec_t(uint32_t) nr;
+	N_t ns;
+} ul_rs_t;
+
+static uint64_t ul_rs_fresh = 0;///the store has been written by this run
+
+static void ul_rs_put_src(FILE *fp, const enzyme *fn)
+{
+	int32_t i; uint64_t x; struct stat st;
+	x = fn->n; fwrite(&x, sizeof(x), 1, fp);
+	for (i = 0; i < fn->n; i++) {
+		x = strlen(fn->a[i]); fwrite(&x, sizeof(x), 1, fp); fwrite(fn->a[i], 1, x, fp);
+		if(stat(fn->a[i], &st) != 0) memset(&st, 0, sizeof(st));
+		x = st.st_size; fwrite(&x, sizeof(x), 1, fp);
+		x = st.st_mtime; fwrite(&x, sizeof(x), 1, fp);
+	}
+}
+
+static uint64_t ul_rs_test_src(FILE *fp, const enzyme *fn)
+{
+	int32_t i; uint64_t x; struct stat st; char *nn = NULL; uint64_t r = 0;
+	if(fread(&x, sizeof(x), 1, fp) != 1 || x != (uint64_t)fn->n) return 0;
+	for (i = 0; i < fn->n; i++) {
+		if(fread(&x, sizeof(x), 1, fp) != 1 || x != strlen(fn->a[i])) goto end;
+		REALLOC(nn, x + 1);
+		if(fread(nn, 1, x, fp) != x || memcmp(nn, fn->a[i], x)) goto end;
+		if(stat(fn->a[i], &st) != 0) goto end;
+		if(fread(&x, sizeof(x), 1, fp) != 1 || x != (uint64_t)st.st_size) goto end;
+		if(fread(&x, sizeof(x), 1, fp) != 1 || x != (uint64_t)st.st_mtime) goto end;
+	}
+	r = 1;
+	end:
+	free(nn);
+	return r;
+}
+
+///open the store of fn for reading if it is complete and up to date; otherwise start writing it
+static uint64_t ul_rs_open(uldat_t *sl, const enzyme *fn)
+{
+	char *gfa_name = (char*)malloc(strlen(asm_opt.output_file_name)+25);
+	uint64_t x; ul_rs_t *r; CALLOC(r, 1);
+	sprintf(gfa_name, "%s.ul.rs.bin", asm_opt.output_file_name);
+	sl->rs = NULL;
+	if(ul_rs_fresh || asm_opt.load_index_from_disk) {
+		r->fp = fopen(gfa_name, "r");
+		if(r->fp && fread(&x, sizeof(x), 1, r->fp) == 1 && x == UL_RS_MA && ul_rs_test_src(r->fp, fn) && 
+											fread(&(r->n), sizeof(r->n), 1, r->fp) == 1 && r->n != (uint64_t)-1) {
+			r->is_rd = 1; sl->rs = r; 
+			fprintf(stderr, "[M::%s] ==> %lu UL reads from %s\n", __func__, (unsigned long)r->n, gfa_name);
+			free(gfa_name);
+			return 1;
+		}
+		if(r->fp) fclose(r->fp);
+	}
+	r->fp = fopen(gfa_name, "w"); free(gfa_name);
+	if(!(r->fp)) {
+		free(r);
+		return 0;
+	}
+	x = UL_RS_MA; fwrite(&x, sizeof(x), 1, r->fp);
+	ul_rs_put_src(r->fp, fn);
+	r->n_off = ftell(r->fp); r->n = (uint64_t)-1; 
+	fwrite(&(r->n), sizeof(r->n), 1, r->fp); r->n = 0;
+	sl->rs = r;
+	return 0;
+}
+
+///is_done: all reads have been written, so that the store can be used by later passes
+static void ul_rs_close(uldat_t *sl, uint64_t is_done)
+{
+	ul_rs_t *r = sl->rs;
+	if(!r) return;
+	if(!(r->is_rd) && is_done) {
+		fseek(r->fp, r->n_off, SEEK_SET);
+		fwrite(&(r->n), sizeof(r->n), 1, r->fp);
+		ul_rs_fresh = 1;
+	}
+	fclose(r->fp); free(r->b.a); free(r->nr.a); free(r->ns.a); free(r);
+	sl->rs = NULL;
+}
+
+static void ul_rs_write(ul_rs_t *r, kseq_t *ks)
+{
+	uint32_t x, k;
+	x = ks->name.l; fwrite(&x, sizeof(x), 1, r->fp); fwrite(ks->name.s, 1, x, r->fp);
+	x = ks->seq.l; fwrite(&x, sizeof(x), 1, r->fp);
+	r->ns.n = 0; r->b.n = (ks->seq.l+3)>>2; kv_resize(uint8_t, r->b, r->b.n);
+	ha_encode_base(r->b.a, ks->seq.s, ks->seq.l, &(r->ns), 0);
+	for (k = 0, r->nr.n = 0; k < r->ns.n; k++) {
+		if(r->nr.n > 0 && r->nr.a[r->nr.n-2] + r->nr.a[r->nr.n-1] == r->ns.a[k]) r->nr.a[r->nr.n-1]++;
+		else {
+			kv_push(uint32_t, r->nr, r->ns.a[k]); kv_push(uint32_t, r->nr, 1);
+		}
+	}
+	x = r->nr.n>>1; fwrite(&x, sizeof(x), 1, r->fp); 
+	fwrite(r->nr.a, sizeof((*(r->nr.a))), r->nr.n, r->fp);
+	fwrite(r->b.a, sizeof((*(r->b.a))), r->b.n, r->fp);
+	r->n++;
+}
+
+static inline void ul_ks_resize(kstring_t *z, uint64_t l)
+{
+	if(z->m >= l + 1) return;
+	z->m = l + 1; kroundup32(z->m);
+	REALLOC(z->s, z->m);
+}
+
+static int64_t ul_rs_read(ul_rs_t *r, kseq_t *ks)
+{
+	uint32_t x, k, l, i;
+	if(fread(&x, sizeof(x), 1, r->fp) != 1) return -1;
+	ul_ks_resize(&(ks->name), x); 
+	if(fread(ks->name.s, 1, x, r->fp) != x) return -1;
+	ks->name.l = x; ks->name.s[x] = 0;
+	if(fread(&l, sizeof(l), 1, r->fp) != 1 || fread(&x, sizeof(x), 1, r->fp) != 1) return -1;
+	r->nr.n = x<<1; kv_resize(uint32_t, r->nr, r->nr.n);
+	if(fread(r->nr.a, sizeof((*(r->nr.a))), r->nr.n, r->fp) != r->nr.n) return -1;
+	r->b.n = (l+3)>>2; kv_resize(uint8_t, r->b, r->b.n);
+	if(fread(r->b.a, sizeof((*(r->b.a))), r->b.n, r->fp) != r->b.n) return -1;
+	ul_ks_resize(&(ks->seq), l + 4); 
+	for (i = 0; i < r->b.n; i++) memcpy(ks->seq.s + (i<<2), bit_t_seq_table[r->b.a[i]], 4);
+	for (k = 0; k < r->nr.n; k += 2) memset(ks->seq.s + r->nr.a[k], 'N', r->nr.a[k+1]);
+	ks->seq.l = l; ks->seq.s[l] = 0;
+	return l;
+}
+
+static inline int64_t ul_kseq_read(uldat_t *p)
+{
+	int64_t ret;
+	if(p->rs && p->rs->is_rd) return ul_rs_read(p->rs, p->ks);
+	ret = kseq_read(p->ks);
+	if(ret >= 0 && p->rs) ul_rs_write(p->rs, p->ks);
+	return ret;
+}
+
+///run a UL pipeline over all reads, from the packed store if possible
+static int ul_run_pipeline(uldat_t* sl, const enzyme *fn, void *(*func)(void*, int, void*), int n_threads, int n_steps)
+{
+	int i;
+	if(ul_rs_open(sl, fn)) {
+		sl->ks = kseq_init(NULL);
+		kt_pipeline(n_threads, func, sl, n_steps);
+		kseq_destroy(sl->ks); sl->ks = NULL;
+		ul_rs_close(sl, 0);
+		return 1;
+	}
+    for (i = 0; i < fn->n; i++){
+        gzFile fp;
+        if ((fp = gzopen(fn->a[i], "r")) == 0) {
+			ul_rs_close(sl, 0);
+			return 0;
+		}
+        sl->ks = kseq_init(fp);
+        kt_pipeline(n_threads, func, sl, n_steps);
+        kseq_destroy(sl->ks);
+        gzclose(fp);
+    }
+	ul_rs_close(sl, 1);
+	return 1;
+}
+
 static void *worker_ul_pipeline(void *data, int step, void *in) // callback for kt_pipeline()
 {
     uldat_t *p = (uldat_t*)data;
@@ -12799,7 +13054,7 @@ static void *worker_ul_pipeline(void *data, int step, void *in) // callback for
 		CALLOC(s, 1);
         s->ha_flt_tab = p->ha_flt_tab; s->ha_idx = p->ha_idx; s->id = p->total_pair; 
 		s->opt = p->opt; s->ug = p->ug; s->uopt = p->uopt; s->rg = p->rg;
-        while ((ret = kseq_read(p->ks)) >= 0) 
+        while ((ret = ul_kseq_read(p)) >= 0) 
         {
             if (p->ks->seq.l < (uint64_t)p->opt->k) continue;
             if (s->n == s->m) {
@@ -12868,15 +13123,7 @@ static void *worker_ul_pipeline(void *data, int step, void *in) // callback for
 int alignment_ul_pipeline(uldat_t* sl, const enzyme *fn)
 {
     double index_time = yak_realtime();
-    int i;
-    for (i = 0; i < fn->n; i++){
-        gzFile fp;
-        if ((fp = gzopen(fn->a[i], "r")) == 0) return 0;
-        sl->ks = kseq_init(fp);
-        kt_pipeline(3, worker_ul_pipeline, sl, 3);
-        kseq_destroy(sl->ks);
-        gzclose(fp);
-    }
+    if(!ul_run_pipeline(sl, fn, worker_ul_pipeline, 3, 3)) return 0;
 	sl->hits.total_base = sl->total_base;
 	sl->hits.total_pair = sl->total_pair;
     fprintf(stderr, "[M::%s::%.3f] ==> Qualification\n", __func__, yak_realtime()-index_time);
@@ -12897,6 +13144,92 @@ void push_uc_block_t(const ug_opt_t *uopt, kv_ul_ov_t *z, char **seq, uint64_t *
 	}
 }
 
+#define UL_MT_READ_LEN 1000000
+
+#define UL_TRI_SKIP 0
+#define UL_TRI_FULL 1
+#define UL_TRI_SEG 16 ///sampled windows per read
+#define UL_TRI_SEG_LEN 2048
+#define UL_TRI_MIN_MZ 32 ///too few sampled minimizers to judge
+
+// data structure for each step in kt_for()
+typedef struct {
+	utepdat_t *s;
+	uint64_t *a; ///read idx; longest first
+	void (*func)(utepdat_t*, long, int, ul_aln_mt_t*);
+	uint8_t *c; ///triage class
+} ul_lpt_t;
+
+///the fraction of sampled minimizers found in the index is ~idy^k if the read is covered by the graph
+static void worker_ul_triage(void *data, long i, int tid) // callback for kt_for()
+{
+	ul_lpt_t *t = (ul_lpt_t*)data; utepdat_t *s = t->s;
+	uint64_t cnt[2]; double idy;
+	ul_sample_anchors(s->hab[tid]->abl, s->seq[i], s->len[i], s->opt->w, s->opt->k, s->ha_flt_tab, s->ha_idx, 
+		&(s->hab[tid]->sp), UL_TRI_SEG, UL_TRI_SEG_LEN, cnt);
+	t->c[i] = UL_TRI_FULL;
+	if(cnt[0] < UL_TRI_MIN_MZ) return;
+	idy = pow((double)cnt[1]/(double)cnt[0], 1.0/(double)s->opt->k);
+	if(idy < asm_opt.ul_triage) t->c[i] = UL_TRI_SKIP;
+}
+
+static void worker_for_ul_lpt(void *data, long i, int tid) // callback for kt_for()
+{
+	ul_lpt_t *t = (ul_lpt_t*)data;
+	t->func(t->s, (uint32_t)t->a[i], tid, NULL);
+}
+
+#define ul_lpt_len(x) (INT32_MAX - (((x)>>32)&INT32_MAX))
+
+///align a batch of UL reads longest first so that no long read is left at the tail of the batch;
+///reads of >= UL_MT_READ_LEN bases go one at a time, with their overlaps aligned by all threads;
+///with --ul-triage, reads whose sparse anchor sample suggests a low identity are not aligned
+static void ul_batch_alignment(utepdat_t *s, int64_t n_thread, void (*func)(utepdat_t*, long, int, ul_aln_mt_t*))
+{
+	ul_lpt_t t; ul_aln_mt_t mt; int64_t i, n_mt, n; uint64_t c;
+	if (s->n <= 0) return;
+	t.s = s; t.func = func; t.c = NULL;
+	MALLOC(t.a, s->n);
+	if(asm_opt.ul_triage > 0) {
+		MALLOC(t.c, s->n);
+		kt_for(n_thread, worker_ul_triage, &t, s->n);
+	}
+	for (i = n = 0; i < s->n; ++i) {
+		c = t.c? t.c[i] : UL_TRI_FULL;
+		s->tri_n[c]++; s->tri_b[c] += s->len[i];
+		if(c == UL_TRI_SKIP) continue;
+		t.a[n++] = ((uint64_t)(INT32_MAX - (s->len[i] < INT32_MAX? s->len[i] : INT32_MAX)))<<32|((uint64_t)i);
+	}
+	free(t.c); t.c = NULL;
+	radix_sort_gfa64(t.a, t.a + n);
+	for (n_mt = 0; n_thread > 1 && n_mt < n && ul_lpt_len(t.a[n_mt]) >= UL_MT_READ_LEN; ++n_mt);
+	if (n_mt > 0) {
+		mt.n_thread = n_thread; 
+		MALLOC(mt.tu, n_thread); MALLOC(mt.exz, n_thread);
+		for (i = 0; i < n_thread; ++i) mt.tu[i] = &(s->hab[i]->ovlp_read), mt.exz[i] = &(s->hab[i]->exz);
+		for (i = 0; i < n_mt; ++i) func(s, (uint32_t)t.a[i], 0, &mt);
+		free(mt.tu); free(mt.exz);
+	}
+	t.a += n_mt;
+	kt_for(n_thread, worker_for_ul_lpt, &t, n - n_mt);
+	t.a -= n_mt; free(t.a);
+}
+
+static void ul_triage_add(uldat_t *p, utepdat_t *s)
+{
+	int64_t c;
+	for (c = 0; c < 2; c++) {
+		p->tri_n[c] += s->tri_n[c]; p->tri_b[c] += s->tri_b[c];
+	}
+}
+
+static void ul_triage_print(const char *func, uldat_t *p)
+{
+	if(asm_opt.ul_triage <= 0) return;
+	fprintf(stderr, "[M::%s::] ==> triage # skipped reads: %lu (%lu bases), # aligned reads: %lu (%lu bases)\n", 
+		func, p->tri_n[UL_TRI_SKIP], p->tri_b[UL_TRI_SKIP], p->tri_n[UL_TRI_FULL], p->tri_b[UL_TRI_FULL]);
+}
+
 static void *worker_ul_scall_pipeline(void *data, int step, void *in) // callback for kt_pipeline()
 {
     uldat_t *p = (uldat_t*)data;
@@ -12908,7 +13241,7 @@ static void *worker_ul_scall_pipeline(void *data, int step, void *in) // callbac
 		CALLOC(s, 1);
         s->ha_flt_tab = p->ha_flt_tab; s->ha_idx = p->ha_idx; s->id = p->total_pair; 
 		s->opt = p->opt; s->uu = p->uu; s->uopt = p->uopt; s->rg = p->rg;
-        while ((ret = kseq_read(p->ks)) >= 0) 
+        while ((ret = ul_kseq_read(p)) >= 0) 
         {
             if ((p->ks->seq.l < (uint64_t)p->opt->k) || (p->ks->seq.l < asm_opt.ul_min_base)) continue;
             if (s->n == s->m) {
@@ -12945,7 +13278,7 @@ static void *worker_ul_scall_pipeline(void *data, int step, void *in) // callbac
 			s->hab[i] = ha_ovec_init(0, 0, 1);
 		}
 		// fprintf(stderr, "[M::%s::Start] ==> s->id: %lu, s->n:% d\n", __func__, s->id, s->n);
-		kt_for(p->n_thread, worker_for_ul_scall_alignment, s, s->n);
+		ul_batch_alignment(s, p->n_thread, ul_scall_alignment); ul_triage_add(p, s);
 		// fprintf(stderr, "[M::%s::Done] ==> s->id: %lu, s->n:% d\n", __func__, s->id, s->n);
 		///debug
 		/**
@@ -13028,6 +13361,68 @@ static void *worker_ul_scall_pipeline(void *data, int step, void *in) // callbac
 }
 
 
+#define UL_GAF_BLK 256 ///UL reads per gzip member
+
+///compress one block of text into a standalone gzip member; concatenated members form a valid .gz file
+static uint64_t ul_gz_deflate(const char *a, uint64_t a_n, uint8_t **r)
+{
+	z_stream z; uint64_t m;
+	memset(&z, 0, sizeof(z)); (*r) = NULL;
+	if(deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return 0;
+	m = deflateBound(&z, a_n) + 32; MALLOC(*r, m);
+	z.next_in = (Bytef*)a; z.avail_in = a_n; z.next_out = *r; z.avail_out = m;
+	if(deflate(&z, Z_FINISH) != Z_STREAM_END) {
+		deflateEnd(&z); free(*r); (*r) = NULL;
+		return 0;
+	}
+	m = z.total_out; deflateEnd(&z);
+	return m;
+}
+
+static void worker_ul_gaf(void *data, long i, int tid) // callback for kt_for()
+{
+	utepdat_t *s = (utepdat_t*)data;
+	const ma_ug_t *ug = s->uu->ug; const ma_utg_t *u; const uc_block_t *p; const ul_vec_t *r; const nid_t *nn;
+	int64_t k, m, st = i*UL_GAF_BLK, en = MIN(st + UL_GAF_BLK, s->n);
+	kstring_t o; memset(&o, 0, sizeof(o));
+	for (k = st; k < en; k++) {
+		r = &(UL_INF.a[s->id+k]); nn = &(UL_INF.nid.a[s->id+k]);
+		for (m = 0; m < (int64_t)r->bb.n; m++) {
+			p = &(r->bb.a[m]);
+			if(p->base || p->hid >= ug->u.n) continue;
+			u = &(ug->u.a[p->hid]);
+			ul_ks_resize(&o, o.l + nn->n + 256);
+			///qs/qe/ts/te are half-open; path coordinates are on the oriented unitig;
+			///uc_block_t keeps no edit distance, so the number of residue matches is reported as 0
+			o.l += sprintf(o.s + o.l, "%.*s\t%lu\t%u\t%u\t+\t%cutg%.6u%c\t%u\t%u\t%u\t0\t%u\t255\ttp:A:%c\n", 
+				(int32_t)nn->n, nn->a, s->len[k], p->qs, p->qe, "><"[p->rev], p->hid + 1, "lc"[u->circ], u->len, 
+				p->rev?u->len-p->te:p->ts, p->rev?u->len-p->ts:p->te, MAX(p->qe-p->qs, p->te-p->ts), p->pchain?'P':'S');
+		}
+	}
+	if(o.l) s->gz_n[i] = ul_gz_deflate(o.s, o.l, &(s->gz[i]));
+	free(o.s);
+}
+
+///format and compress the GAF records of a batch with all threads
+static void ul_gaf_gen(uldat_t *p, utepdat_t *s)
+{
+	s->gz_b = p->gaf? (s->n + UL_GAF_BLK - 1) / UL_GAF_BLK : 0;
+	if(s->gz_b == 0) return;
+	CALLOC(s->gz, s->gz_b); CALLOC(s->gz_n, s->gz_b);
+	kt_for(p->n_thread, worker_ul_gaf, s, s->gz_b);
+}
+
+static void ul_gaf_dump(uldat_t *p, utepdat_t *s)
+{
+	int64_t i;
+	for (i = 0; i < s->gz_b; i++) {
+		if(s->gz_n[i]) fwrite(s->gz[i], 1, s->gz_n[i], p->gaf);
+		free(s->gz[i]);
+	}
+	free(s->gz); free(s->gz_n);
+	s->gz = NULL; s->gz_n = NULL; s->gz_b = 0;
+}
+
 static void *worker_ul_rescall_pipeline(void *data, int step, void *in) // callback for kt_pipeline()
 {
     uldat_t *p = (uldat_t*)data;
@@ -13039,7 +13434,7 @@ static void *worker_ul_rescall_pipeline(void *data, int step, void *in) // callb
 		CALLOC(s, 1);
         s->ha_flt_tab = p->ha_flt_tab; s->ha_idx = p->ha_idx; s->id = p->total_pair; 
 		s->opt = p->opt; s->uu = p->uu; s->uopt = p->uopt; s->rg = p->rg; s->mm = p->mm;
-        while ((ret = kseq_read(p->ks)) >= 0) 
+        while ((ret = ul_kseq_read(p)) >= 0) 
         {
 			if ((p->ks->seq.l < (uint64_t)p->opt->k) || (p->ks->seq.l < asm_opt.ul_min_base)) continue;
             if (s->n == s->m) {
@@ -13076,7 +13471,7 @@ static void *worker_ul_rescall_pipeline(void *data, int step, void *in) // callb
 			s->hab[i] = ha_ovec_init(0, 0, 1); s->buf[i] = mg_tbuf_init();
 		}
 		// fprintf(stderr, "[M::%s::Start] ==> s->id: %lu, s->n:% d\n", __func__, s->id, s->n);
-		kt_for(p->n_thread, worker_for_ul_rescall_alignment, s, s->n);
+		ul_batch_alignment(s, p->n_thread, ul_rescall_alignment); ul_triage_add(p, s);
 		// fprintf(stderr, "[M::%s::Done] ==> s->id: %lu, s->n:% d\n", __func__, s->id, s->n);
 		// get_utepdat_t_mem(s, 1);
 
@@ -13093,6 +13488,7 @@ static void *worker_ul_rescall_pipeline(void *data, int step, void *in) // callb
 		}
 		free(s->hab); free(s->ll); free(s->mk); ///free(s->len); free(s->seq); 
 		free(s->buf); free(s->gdp); free(s->mzs); free(s->sps); ///free(s);
+		ul_gaf_gen(p, s);
 		return s;
     } else if (step == 2) { // step 3: dump
 		utepdat_t *s = (utepdat_t*)in; int64_t i, rid;
@@ -13109,6 +13505,7 @@ static void *worker_ul_rescall_pipeline(void *data, int step, void *in) // callb
 			free(s->seq[i]);
 		}
 		// fprintf(stderr, "[M::%s::dump_done] ==> s->id: %lu, s->n:% d\n", __func__, s->id, s->n);
+		ul_gaf_dump(p, s);
 		free(s->len); free(s->seq); free(s);
 	}
     return 0;
@@ -13125,7 +13522,7 @@ static void *worker_ul_recorrect_pipeline(void *data, int step, void *in) // cal
 		CALLOC(s, 1);
         s->ha_flt_tab = p->ha_flt_tab; s->ha_idx = p->ha_idx; s->id = p->total_pair; 
 		s->opt = p->opt; s->uu = p->uu; s->uopt = p->uopt; s->rg = p->rg;
-        while ((ret = kseq_read(p->ks)) >= 0) 
+        while ((ret = ul_kseq_read(p)) >= 0) 
         {
             if (p->ks->seq.l < (uint64_t)p->opt->k) continue;
             if (s->n == s->m) {
@@ -13197,6 +13594,25 @@ int32_t init_ucr_file_t(uldat_t *sl, char* file, uint64_t mode)
 }
 
 
+///--ul-gaf: UL-to-unitig alignments of this round go to <file>.ul.gaf.gz
+int32_t init_ul_gaf(uldat_t *sl, char* file)
+{
+	if(!asm_opt.ul_gaf) return 0;
+	char *gaf_name = (char*)malloc(strlen(file)+25);
+	sprintf(gaf_name, "%s.ul.gaf.gz", file);
+	sl->gaf = fopen(gaf_name, "w");
+	if (!(sl->gaf)) fprintf(stderr, "[M::%s] Cannot open %s\n", __func__, gaf_name);
+	free(gaf_name);
+	return !!(sl->gaf);
+}
+
+void destroy_ul_gaf(uldat_t *sl)
+{
+	if(sl->gaf) {
+		fclose(sl->gaf); sl->gaf = NULL;
+	}
+}
+
 void destory_ucr_file_t(uldat_t *sl)
 {
 	if(sl->ucr_s) {
@@ -13764,7 +14180,7 @@ void ug2rg_gen(ul_ov_t *a, int64_t an, ul_vec_t *qn, const ul_idx_t *uref, ul_ve
 {
 	ul_ov_t *ot, p, res; uint64_t i, l, m; 
 	ma_utg_t *u; uc_block_t *b; int64_t z, ff, iqs, iqe, its, ite; 
-
+	ul_bb_own(rch);
 
 	for (z = 0; z < an; z++) {
 		gen_end_coord(&(a[z]), rch->rlen, uref->ug->u.a[a[z].tn].len, &iqs, &iqe, NULL, NULL);
@@ -15819,7 +16235,7 @@ void dd_ul_vec_t(const ul_idx_t *uref, mg_lchain_t *a, int64_t a_n, ul_vec_t *rc
 		}
 	}
 
-	
+	ul_bb_own(rch);
 	for (i = 0; i < rch->bb.n; i++) {
 		rch->bb.a[i].pidx = 0xfffffffe;
 		rch->bb.a[i].aidx = rch->bb.a[i].pdis = (uint32_t)-1;
@@ -16058,7 +16474,8 @@ void push_ctg_res(ul_vec_t *rch, vec_mg_lchain_t *uc, uint64_t id)
 	// UL_INF.nid.a[ulid].n, UL_INF.nid.a[ulid].a, ulid, rch->rlen);
 
 	uint64_t k, ucn = uc->n; uint64_t tt, s, e, z, rrn; mg_lchain_t *ix; uc_block_t *p; uc_block_t *rr; mg_lchain_t *src; 
-	for (k = 0, rch->bb.n = 0, tt = 0; k < ucn; k += ix->cnt + 1) {
+	rch->bb.n = 0; ul_bb_own(rch);
+	for (k = 0, tt = 0; k < ucn; k += ix->cnt + 1) {
 		ix = &(uc->a[k]); assert(ix->v == (uint32_t)-1);
 		kv_pushp(uc_block_t, rch->bb, &p); memset(p, 0, sizeof((*p))); 
 		p->hid = k/**(uint32_t)-1**/; p->qs = ix->qs; p->qe = ix->qe; p->ts = ix->cnt; tt += ix->cnt;
@@ -18251,7 +18668,7 @@ uint32_t update_consensus_chain(const ug_opt_t *uopt, const asg_t *rg, kv_ul_ov_
 	}
 
 	uc_block_t *z, *p; int64_t tt;
-	kv_resize(uc_block_t, rch->bb, idx->n); rch->bb.n = 0;
+	rch->bb.n = 0; ul_bb_own(rch); kv_resize(uc_block_t, rch->bb, idx->n);
 	for (k = 0; k < idx->n; k++) {
 		// fprintf(stderr, "+k::%lu[M::%s::id->%u] q::[%u, %u), t::[%u, %u), is_cr::%u\n", 
 		// k, __func__, idx->a[k].tn, idx->a[k].qs, idx->a[k].qe, idx->a[k].ts, idx->a[k].te, 
@@ -19992,17 +20409,9 @@ static void update_ovlp_src_bl(void *data, long i, int tid)
 int scall_ul_pipeline(uldat_t* sl, const enzyme *fn)
 {
     double index_time = yak_realtime();
-    int i;
 
 	init_all_ul_t(&UL_INF, &R_INF);
-    for (i = 0; i < fn->n; i++){
-        gzFile fp;
-        if ((fp = gzopen(fn->a[i], "r")) == 0) return 0;
-        sl->ks = kseq_init(fp);
-        kt_pipeline(3, worker_ul_scall_pipeline, sl, 3);
-        kseq_destroy(sl->ks);
-        gzclose(fp);
-    }
+    if(!ul_run_pipeline(sl, fn, worker_ul_scall_pipeline, 3, 3)) return 0;
 	sl->hits.total_base = sl->total_base;
 	sl->hits.total_pair = sl->total_pair;
     fprintf(stderr, "[M::%s::%.3f] ==> Qualification\n", __func__, yak_realtime()-index_time);
@@ -20010,6 +20419,7 @@ int scall_ul_pipeline(uldat_t* sl, const enzyme *fn)
 	// fprintf(stderr, "[M::%s::] ==> # bases: %lu; # corrected bases: %lu; # recorrected bases: %lu\n", 
 	// __func__, sl->num_bases, sl->num_corrected_bases, sl->num_recorrected_bases);
 	fprintf(stderr, "[M::%s::] ==> # fully covered reads: %lu\n", __func__, sl->num_bases);
+	ul_triage_print(__func__, sl);
 	gen_ul_vec_rid_t(&UL_INF, &R_INF, NULL);
     return 1;
 }
@@ -20018,23 +20428,16 @@ int scall_ul_pipeline(uldat_t* sl, const enzyme *fn)
 int rescall_ul_pipeline(uldat_t* sl, const enzyme *fn)
 {
     double index_time = yak_realtime();
-    int32_t i; 
 	///debug
 	// overall_zdbg = init_mul_debug_prt_t(UL_INF.n);
 
-    for (i = 0; i < fn->n; i++){
-        gzFile fp;
-        if ((fp = gzopen(fn->a[i], "r")) == 0) return 0;
-        sl->ks = kseq_init(fp);
-        kt_pipeline(3, worker_ul_rescall_pipeline, sl, 3);
-        kseq_destroy(sl->ks);
-        gzclose(fp);
-    }
+    if(!ul_run_pipeline(sl, fn, worker_ul_rescall_pipeline, 3, 3)) return 0;
 	sl->hits.total_base = sl->total_base;
 	sl->hits.total_pair = sl->total_pair;
     fprintf(stderr, "[M::%s::%.3f] ==> Qualification\n", __func__, yak_realtime()-index_time);
 	fprintf(stderr, "[M::%s::] ==> # reads: %lu, # bases: %lu, # fully corrected reads: %lu\n", 
 	__func__, UL_INF.n, sl->total_base, sl->num_corrected_bases);
+	ul_triage_print(__func__, sl);
 	// fprintf(stderr, "[M::%s::] ==> # bases: %lu; # corrected bases: %lu; # recorrected bases: %lu\n", 
 	// __func__, sl->num_bases, sl->num_corrected_bases, sl->num_recorrected_bases);
 	// gen_ul_vec_rid_t(&UL_INF);
@@ -20051,16 +20454,8 @@ int rescall_ul_pipeline(uldat_t* sl, const enzyme *fn)
 int recorrect_ul_pipeline(uldat_t* sl, const enzyme *fn)
 {
     double index_time = yak_realtime();
-    int32_t i; 
 
-    for (i = 0; i < fn->n; i++){
-        gzFile fp;
-        if ((fp = gzopen(fn->a[i], "r")) == 0) return 0;
-        sl->ks = kseq_init(fp);
-        kt_pipeline(2, worker_ul_recorrect_pipeline, sl, 2);
-        kseq_destroy(sl->ks);
-        gzclose(fp);
-    }
+    if(!ul_run_pipeline(sl, fn, worker_ul_recorrect_pipeline, 2, 2)) return 0;
 	sl->hits.total_base = sl->total_base;
 	sl->hits.total_pair = sl->total_pair;
     fprintf(stderr, "[M::%s::%.3f] ==> Qualification\n", __func__, yak_realtime()-index_time);
@@ -20559,13 +20954,13 @@ int ul_align(mg_idxopt_t *opt, const ug_opt_t *uopt, const asg_t *rg, const enzy
 void ul_resolve(ma_ug_t *ug, const asg_t *rg, const ug_opt_t *uopt, int hap_n)
 {
 	fprintf(stderr, "[M::%s::] ==> UL\n", __func__);
-    mg_idxopt_t opt;
+    mg_idxopt_t opt; void *flt_tab = NULL; ha_pt_t *idx = NULL;
     init_mg_opt(&opt, 0, 19, 10, hap_n, 0, 0, 0.05, asm_opt.ul_error_rate_low, asm_opt.ul_error_rate_hpc, asm_opt.ul_ec_round);
-	int exist = (asm_opt.load_index_from_disk? uidx_load(&ha_flt_tab, &ha_idx, asm_opt.output_file_name, NULL) : 0);
-    if(exist == 0) uidx_build(ug, &opt);
-	if(exist == 0) uidx_write(ha_flt_tab, ha_idx, asm_opt.output_file_name, NULL);
-    ul_align(&opt, uopt, rg, asm_opt.ar, ha_flt_tab, ha_idx, ug);
-    uidx_destory();
+	int exist = (asm_opt.load_index_from_disk? uidx_load(&flt_tab, &idx, asm_opt.output_file_name, NULL) : 0);
+    if(exist == 0) uidx_build(ug, &opt, &flt_tab, &idx);
+	if(exist == 0) uidx_write(flt_tab, idx, asm_opt.output_file_name, NULL);
+    ul_align(&opt, uopt, rg, asm_opt.ar, flt_tab, idx, ug);
+    uidx_destory(flt_tab, idx);
 }
 
 void ul_v_call(uldat_t *sl, const enzyme *fn)
@@ -21472,16 +21867,16 @@ void destroy_idx_emask_t(idx_emask_t *mm)
 
 void gen_UL_ovlps(uldat_t *sl, int32_t cutoff)
 {
-	ul_idx_t *uu = dedup_HiFis(sl->uopt, 1, 0);
+	ul_idx_t *uu = dedup_HiFis(sl->uopt, 1, 0); void *flt_tab = NULL; ha_pt_t *idx = NULL;
 	///for unitig index
-	int exist = (asm_opt.load_index_from_disk? uidx_load(&ha_flt_tab, &ha_idx, asm_opt.output_file_name, NULL) : 0);
-    if(exist == 0) uidx_l_build(uu->ug, (mg_idxopt_t *)sl->opt, cutoff);
-	if(exist == 0) uidx_write(ha_flt_tab, ha_idx, asm_opt.output_file_name, NULL);
+	int exist = (asm_opt.load_index_from_disk? uidx_load(&flt_tab, &idx, asm_opt.output_file_name, NULL) : 0);
+    if(exist == 0) uidx_l_build(uu->ug, (mg_idxopt_t *)sl->opt, cutoff, &flt_tab, &idx);
+	if(exist == 0) uidx_write(flt_tab, idx, asm_opt.output_file_name, NULL);
 	// print_debug_gfa(sl->uopt, ug, coverage_cut, "debug_dups", sources, ruIndex, asm_opt.max_hang_Len, asm_opt.min_overlap_Len);
-	sl->ha_flt_tab = ha_flt_tab; sl->ha_idx = (ha_pt_t *)ha_idx; sl->uu = uu;		
+	sl->ha_flt_tab = flt_tab; sl->ha_idx = idx; sl->uu = uu;		
 	ul_v_call(sl, asm_opt.ar);
 	// print_raw_u2rgfa_seq(&UL_INF, uu, 1);
-	destroy_ul_idx_t(uu); ha_ft_destroy(ha_flt_tab); ha_pt_destroy(ha_idx);
+	destroy_ul_idx_t(uu); ha_ft_destroy(flt_tab); ha_pt_destroy(idx);
 	sl->ha_flt_tab = NULL; sl->ha_idx = NULL; sl->uu = NULL;
 }
 
@@ -21537,10 +21932,11 @@ int32_t write_emask_t(idx_emask_t *x, char* file_name, ma_ug_t *ug)
 void gen_UL_reovlps(uldat_t *sl, ma_ug_t *ug, asg_t *sg, char* gfa_name, int32_t cutoff, int32_t is_emask)
 {
 	ul_idx_t *uu = gen_ul_idx(sl->uopt, ug, sg);
-	int exist = (asm_opt.load_index_from_disk? uidx_load(&ha_flt_tab, &ha_idx, gfa_name, ug) : 0);
-    if(exist == 0) uidx_l_build(uu->ug, (mg_idxopt_t *)sl->opt, cutoff);
-	if(exist == 0) uidx_write(ha_flt_tab, ha_idx, gfa_name, ug);
-	sl->ha_flt_tab = ha_flt_tab; sl->ha_idx = (ha_pt_t *)ha_idx; sl->uu = uu;	
+	void *flt_tab = NULL; ha_pt_t *idx = NULL;
+	int exist = (asm_opt.load_index_from_disk? uidx_load(&flt_tab, &idx, gfa_name, ug) : 0);
+    if(exist == 0) uidx_l_build(uu->ug, (mg_idxopt_t *)sl->opt, cutoff, &flt_tab, &idx);
+	if(exist == 0) uidx_write(flt_tab, idx, gfa_name, ug);
+	sl->ha_flt_tab = flt_tab; sl->ha_idx = idx; sl->uu = uu;	
 	if(is_emask) {
 		if((!(asm_opt.load_index_from_disk)) || (!load_emask_t(&(sl->mm), gfa_name, ug))) {
 			sl->mm = graph_ovlp_binning(ug, sg, sl->uopt);
@@ -21548,11 +21944,11 @@ void gen_UL_reovlps(uldat_t *sl, ma_ug_t *ug, asg_t *sg, char* gfa_name, int32_t
 		}
 	}
 
-	init_ucr_file_t(sl, gfa_name, 1);
+	init_ucr_file_t(sl, gfa_name, 1); init_ul_gaf(sl, gfa_name);
 	ul_v_recall(sl, asm_opt.ar);
-	destory_ucr_file_t(sl);
+	destory_ucr_file_t(sl); destroy_ul_gaf(sl);
 	///do not free ug
-	uu->ug = NULL; destroy_ul_idx_t(uu); ha_ft_destroy(ha_flt_tab); ha_pt_destroy(ha_idx);
+	uu->ug = NULL; destroy_ul_idx_t(uu); uidx_destory(flt_tab, idx);
 	sl->ha_flt_tab = NULL; sl->ha_idx = NULL; sl->uu = NULL;
 	destroy_idx_emask_t(sl->mm); free(sl->mm); sl->mm = NULL;
 	// exit(1);
@@ -21569,16 +21965,17 @@ uint32_t drenew_UL_reovlps(uldat_t *sl, ma_ug_t *ug, asg_t *sg, char* gfa_name,
 	if(f_occ == 0) return 0;//all set
 
 	ul_idx_t *uu = gen_ul_idx(sl->uopt, ug, sg);
-	int exist = (asm_opt.load_index_from_disk? uidx_load(&ha_flt_tab, &ha_idx, gfa_name, ug) : 0);
-    if(exist == 0) uidx_l_build(uu->ug, (mg_idxopt_t *)sl->opt, cutoff);
-	if(exist == 0) uidx_write(ha_flt_tab, ha_idx, gfa_name, ug);
-	sl->ha_flt_tab = ha_flt_tab; sl->ha_idx = (ha_pt_t *)ha_idx; sl->uu = uu;	
+	void *flt_tab = NULL; ha_pt_t *idx = NULL;
+	int exist = (asm_opt.load_index_from_disk? uidx_load(&flt_tab, &idx, gfa_name, ug) : 0);
+    if(exist == 0) uidx_l_build(uu->ug, (mg_idxopt_t *)sl->opt, cutoff, &flt_tab, &idx);
+	if(exist == 0) uidx_write(flt_tab, idx, gfa_name, ug);
+	sl->ha_flt_tab = flt_tab; sl->ha_idx = idx; sl->uu = uu;	
 
 	// init_ucr_file_t(sl, gfa_name, 1);
 	recorrect_ul_pipeline(sl, asm_opt.ar);
 	// destory_ucr_file_t(sl);
 	///do not free ug
-	uu->ug = NULL; destroy_ul_idx_t(uu); ha_ft_destroy(ha_flt_tab); ha_pt_destroy(ha_idx);
+	uu->ug = NULL; destroy_ul_idx_t(uu); uidx_destory(flt_tab, idx);
 	sl->ha_flt_tab = NULL; sl->ha_idx = NULL; sl->uu = NULL;
 	return 1;
 	// exit(1);
@@ -21671,7 +22068,7 @@ int32_t load_all_ul_t(all_ul_t *x, char* file_name, All_reads *hR, ma_ug_t *ug)
 
 	fread(&x->n, sizeof(x->n), 1, fp); x->m = x->n; MALLOC(x->a, x->n);
 	for (k = 0; k < x->n; k++) {
-		p = &(x->a[k]);
+		p = &(x->a[k]); p->pg = 0;
 		fread(&p->dd, sizeof(p->dd), 1, fp);
 		fread(&p->rlen, sizeof(p->rlen), 1, fp);
 
@@ -21705,6 +22102,7 @@ void ul_load(const ug_opt_t *uopt)
 		write_all_ul_t(&UL_INF, asm_opt.output_file_name, NULL);
 		// exit(1);
 	}
+	spill_ul_t(&UL_INF, asm_opt.output_file_name);
 	// detect_outlier_len("ul_load");
 	// print_all_ul_t_stat(&UL_INF);
 	// fprintf(stderr, "**1**\n");
@@ -22006,9 +22404,11 @@ void clear_all_ul_t(all_ul_t *x)
 	uint64_t k, rlen;
 	for (k = 0; k < x->n; k++) {
         rlen = x->a[k].rlen;
-        free(x->a[k].bb.a); free(x->a[k].N_site.a); free(x->a[k].r_base.a); 
+        ul_vec_free(&(x->a[k]));
         memset(&(x->a[k]), 0, sizeof(x->a[k])); x->a[k].rlen = rlen;
     }
+    for (k = 0; k < x->mm.n; k++) munmap(x->mm.a[k].a, x->mm.a[k].n);
+    x->mm.n = 0;
 	free(x->ridx.idx.a); free(x->ridx.occ.a); memset(&(x->ridx), 0, sizeof((x->ridx)));
 
 	// if(x->mm) {
@@ -22892,6 +23292,7 @@ ma_ug_t *ul_realignment(const ug_opt_t *uopt, asg_t *sg, uint32_t double_check_c
 		// exit(1);
 		write_all_ul_t(&UL_INF, gfa_name, ug);
 	} else{
+		if(asm_opt.ul_gaf) fprintf(stderr, "[M::%s] UL alignments were loaded from %s.ul.ovlp.bin; %s.ul.gaf.gz is not written\n", __func__, gfa_name, gfa_name);
 		free(UL_INF.ridx.idx.a); free(UL_INF.ridx.occ.a); 
 		memset(&(UL_INF.ridx), 0, sizeof((UL_INF.ridx)));
 		if(double_check_cache){
@@ -22900,6 +23301,7 @@ ma_ug_t *ul_realignment(const ug_opt_t *uopt, asg_t *sg, uint32_t double_check_c
 			}
 		}
 	}
+	spill_ul_t(&UL_INF, gfa_name);
 
 	// print_ul_alignment(ug, &UL_INF, 147, "init-0");
 	filter_ul_ug(ug);
@@ -22948,6 +23350,7 @@ ma_ug_t *ul_realignment_back(const ug_opt_t *uopt, asg_t *sg, uint32_t double_ch
 		// exit(1);
 		write_all_ul_t(&UL_INF, gfa_name, ug);
 	} else{
+		if(asm_opt.ul_gaf) fprintf(stderr, "[M::%s] UL alignments were loaded from %s.ul.ovlp.bin; %s.ul.gaf.gz is not written\n", __func__, gfa_name, gfa_name);
 		free(UL_INF.ridx.idx.a); free(UL_INF.ridx.occ.a); 
 		memset(&(UL_INF.ridx), 0, sizeof((UL_INF.ridx)));
 		if(double_check_cache){
@@ -22956,6 +23359,7 @@ ma_ug_t *ul_realignment_back(const ug_opt_t *uopt, asg_t *sg, uint32_t double_ch
 			}
 		}
 	}
+	spill_ul_t(&UL_INF, gfa_name);
 
 	// print_ul_alignment(ug, &UL_INF, 41927, "init-0");
 	filter_ul_ug(ug);
@@ -32,7 +32,7 @@
 typedef struct {
 	int w, k, bw, max_gap, is_HPC, hap_n, occ_weight, max_gap_pre, max_gc_seq_ext, seed;
 	int max_lc_skip, max_lc_iter, min_lc_cnt, min_lc_score, max_gc_skip, ref_bonus;
-	int min_gc_cnt, min_gc_score, sub_diff, best_n;
+	int min_gc_cnt, min_gc_score, sub_diff, best_n, lc_rmq;
     float chn_pen_gap, mask_level, pri_ratio;
 	///base-alignment
 	double bw_thres, diff_ec_ul, diff_ec_ul_low, diff_ec_ul_hpc; int max_n_chain, ec_ul_round;
@@ -30,6 +30,8 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include "kthread.h"
 
 typedef struct {
 	void *left, *right;
@@ -220,4 +222,88 @@ typedef const char *ksstr_t;
 		else rs_sort_##name(beg, end, 8, sizeof_key * 8 - 8); \
 	}
 
+/* multi-threaded radix sort; requires KRADIX_SORT_INIT(name, ...) first. The top digit is taken
+   from the highest bit at which the keys differ, counted in per-block histograms and scattered in
+   parallel into a temporary buffer; each bucket is then sorted by its own thread. The blocks only
+   depend on the number of elements, so the result does not depend on the number of threads. */
+#define RS_MT_MIN_SIZE 65536
+#define RS_MT_N_BLK 256
+
+#define KRADIX_SORT_MT_INIT(name, rstype_t, rskey, sizeof_key) \
+	typedef struct { \
+		rstype_t *a, *t; \
+		size_t n, *cnt, bnd[257]; \
+		uint64_t km[RS_MT_N_BLK<<1]; \
+		int s; \
+	} rsmt_##name##_t; \
+	void rsmt_range_##name(void *data, long i, int tid) \
+	{ \
+		rsmt_##name##_t *p = (rsmt_##name##_t*)data; \
+		size_t j, e = p->n * (i + 1) / RS_MT_N_BLK; \
+		uint64_t o = 0, d = (uint64_t)-1, x; \
+		for (j = p->n * i / RS_MT_N_BLK; j < e; ++j) \
+			x = (uint64_t)rskey(p->a[j]), o |= x, d &= x; \
+		p->km[i<<1] = o, p->km[i<<1|1] = d; \
+	} \
+	void rsmt_count_##name(void *data, long i, int tid) \
+	{ \
+		rsmt_##name##_t *p = (rsmt_##name##_t*)data; \
+		size_t j, e = p->n * (i + 1) / RS_MT_N_BLK, *c = p->cnt + (i<<8); \
+		for (j = p->n * i / RS_MT_N_BLK; j < e; ++j) \
+			++c[(uint64_t)rskey(p->a[j])>>p->s&0xff]; \
+	} \
+	void rsmt_scatter_##name(void *data, long i, int tid) \
+	{ \
+		rsmt_##name##_t *p = (rsmt_##name##_t*)data; \
+		size_t j, e = p->n * (i + 1) / RS_MT_N_BLK, *c = p->cnt + (i<<8); \
+		for (j = p->n * i / RS_MT_N_BLK; j < e; ++j) \
+			p->t[c[(uint64_t)rskey(p->a[j])>>p->s&0xff]++] = p->a[j]; \
+	} \
+	void rsmt_bucket_##name(void *data, long i, int tid) \
+	{ \
+		rsmt_##name##_t *p = (rsmt_##name##_t*)data; \
+		size_t b = p->bnd[i], e = p->bnd[i+1]; \
+		if (e == b) return; \
+		memcpy(p->a + b, p->t + b, (e - b) * sizeof(rstype_t)); \
+		if (p->s == 0) return; /* keys within a bucket are identical */ \
+		if (e - b > RS_MIN_SIZE) rs_sort_##name(p->a + b, p->a + e, 8, p->s > 8? p->s - 8 : 0); \
+		else if (e - b > 1) rs_insertsort_##name(p->a + b, p->a + e); \
+	} \
+	void radix_sort_mt_##name(rstype_t *beg, rstype_t *end, int n_threads) \
+	{ \
+		rsmt_##name##_t *p; \
+		size_t i, j, c; \
+		uint64_t o = 0, d = (uint64_t)-1; \
+		if (end - beg < RS_MT_MIN_SIZE) { \
+			radix_sort_##name(beg, end); \
+			return; \
+		} \
+		p = (rsmt_##name##_t*)calloc(1, sizeof(*p)); \
+		p->a = beg, p->n = end - beg; \
+		kt_for(n_threads, rsmt_range_##name, p, RS_MT_N_BLK); \
+		for (i = 0; i < RS_MT_N_BLK; ++i) o |= p->km[i<<1], d &= p->km[i<<1|1]; \
+		if ((o ^ d) == 0) { free(p); return; } \
+		p->s = 63 - __builtin_clzll(o ^ d); \
+		p->s = p->s > 7? p->s - 7 : 0; \
+		p->t = (rstype_t*)malloc(p->n * sizeof(rstype_t)); \
+		p->cnt = (size_t*)calloc(RS_MT_N_BLK<<8, sizeof(size_t)); \
+		if (p->t == NULL || p->cnt == NULL) { \
+			free(p->t); free(p->cnt); free(p); \
+			radix_sort_##name(beg, end); \
+			return; \
+		} \
+		kt_for(n_threads, rsmt_count_##name, p, RS_MT_N_BLK); \
+		for (j = 0, c = 0; j < 256; ++j) { \
+			p->bnd[j] = c; \
+			for (i = 0; i < RS_MT_N_BLK; ++i) { \
+				size_t x = p->cnt[(i<<8)|j]; \
+				p->cnt[(i<<8)|j] = c, c += x; \
+			} \
+		} \
+		p->bnd[256] = c; \
+		kt_for(n_threads, rsmt_scatter_##name, p, RS_MT_N_BLK); \
+		kt_for(n_threads, rsmt_bucket_##name, p, 256); \
+		free(p->t); free(p->cnt); free(p); \
+	}
+
 #endif
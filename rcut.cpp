@@ -55,6 +55,8 @@ typedef struct {
 	mc_pairsc_t *z, *z_opt;///keep scores to nodes(1) and nodes(-1)
 	int8_t *s, *s_opt;
 	uint8_t *f;
+	asg32_v cq[2];///candidates of mc_optimize_local()
+	uint8_t *cf;///if a node is in cq
 } mc_svaux_t;
 
 
@@ -1256,6 +1258,31 @@ void mc_g_cc(mc_match_t *ma)
 {
 	ma->cc = mc_g_cc_core(ma);
 }
+
+///connected components with >= 2 nodes, largest first; (~size)<<32|offset in ma->cc
+uint64_t *mc_g_cc_srt(const mc_match_t *ma, uint32_t *n, uint32_t *max_cc)
+{
+	uint32_t st, i, m = 0; uint64_t *a; 
+	MALLOC(a, ma->n_seq + 1); if(max_cc) *max_cc = 0;
+	for (st = 0, i = 1; i <= ma->n_seq; ++i) {
+		if (i == ma->n_seq || ma->cc[st]>>32 != ma->cc[i]>>32) {
+			if(max_cc && (*max_cc) < i - st) *max_cc = i - st;
+			if(i - st >= 2) a[m++] = ((uint64_t)((uint32_t)-1 - (i - st)))<<32 | st;
+			st = i;
+		}
+	}
+	radix_sort_mc64(a, a + m);
+	*n = m;
+	return a;
+}
+
+///RNG seed of a component; independent of the order and the thread the component is solved in;
+///unlike the old single stream carried across components, this changes the random starts and the
+///local search of every component but the first, so phasing can differ from older releases beyond label swaps
+static inline uint64_t mc_cc_seed(const mc_opt_t *opt, const mc_match_t *ma, uint32_t cc_off)
+{
+	return kr_splitmix64(opt->seed ^ (uint64_t)((uint32_t)ma->cc[cc_off]));
+}
 mc_bp_t *mc_bp_t_init(mc_match_t *ma, mc_svaux_t *b_aux, bubble_type* bub, uint64_t n_thread)
 {
 	uint32_t i, k, n;
@@ -1331,6 +1358,8 @@ mc_svaux_t *mc_svaux_init(const mc_g_t *mg, uint64_t x)
 	CALLOC(b->z, ma->n_seq);
 	CALLOC(b->z_opt, ma->n_seq);
 	CALLOC(b->f, ma->n_seq);
+	kv_init(b->cq[0]); kv_init(b->cq[1]);
+	CALLOC(b->cf, ma->n_seq);
 	return b;
 }
 void mc_svaux_destroy(mc_svaux_t *b)
@@ -1341,9 +1370,29 @@ void mc_svaux_destroy(mc_svaux_t *b)
 	free(b->z); free(b->z_opt);
 	free(b->bfs); free(b->bfs_mark);
 	free(b->f);
+	kv_destroy(b->cq[0]); kv_destroy(b->cq[1]); free(b->cf);
 	free(b);
 }
 
+///per-thread copy of b; arrays indexed by node are shared since components are disjoint
+mc_svaux_t *mc_svaux_dup(const mc_svaux_t *b, uint32_t max_cc)
+{
+	mc_svaux_t *p; CALLOC(p, 1);
+	*p = *b;
+	kv_init(p->cc_edge);
+	MALLOC(p->cc_node, max_cc);
+	MALLOC(p->bfs, max_cc);
+	kv_init(p->cq[0]); kv_init(p->cq[1]);
+	return p;
+}
+
+void mc_svaux_dup_destroy(mc_svaux_t *p)
+{
+	kv_destroy(p->cc_edge); free(p->cc_node); free(p->bfs);
+	kv_destroy(p->cq[0]); kv_destroy(p->cq[1]);
+	free(p);
+}
+
 
 mb_svaux_t *mb_svaux_init(const mb_g_t *mg, uint64_t x)
 {
@@ -1699,27 +1748,43 @@ void mc_best_flip(const mc_match_t *ma, mc_svaux_t *b)
 	}
 }
 
+///1 if k is not at the spin favored by its neighbours, i.e. flipping k raises the score
+#define mc_gain_pos(b, k) ((b)->z[(k)].z[0] != (b)->z[(k)].z[1] && (b)->s[(k)] != ((b)->z[(k)].z[0] > (b)->z[(k)].z[1]? -1 : 1))
+
 static t_w_t mc_optimize_local(const mc_opt_t *opt, const mc_match_t *ma, mc_svaux_t *b, uint32_t *n_iter)
 {
-	uint32_t i, n_flip = 0;
+	uint32_t i, j, k, t, o, n, n_flip = 0;
 	int32_t n_iter_local = 0;
+	asg32_v c;
+	///only nodes with a positive gain are visited; a flip may only add its neighbours
+	for (i = b->cq[0].n = 0; i < b->cc_size; ++i) {
+		k = (uint32_t)ma->cc[b->cc_off + i];///uid
+		b->cf[k] = 0;
+		if (!mc_gain_pos(b, k)) continue;
+		kv_push(uint32_t, b->cq[0], k); b->cf[k] = 1;
+	}
 	while (n_iter_local < opt->max_iter) {
 		++(*n_iter);
-		ks_shuffle_uint32_t(b->cc_size, b->cc_node, &b->x);
-		for (i = n_flip = 0; i < b->cc_size; ++i) {
-			uint32_t k = b->cc_node[i];///uid
-			int8_t s;
-			if (b->z[k].z[0] == b->z[k].z[1]) continue;
-			s = b->z[k].z[0] > b->z[k].z[1]? -1 : 1;
-			if (b->s[k] != s) {
-				// fprintf(stderr, "utg%.6dl, s[k]::%d, s::%d\n", (int32_t)(k)+1, b->s[k], s);
-				mc_set_spin(ma, b, k, s);///no need to change the score of k itself
-				++n_flip;
+		ks_shuffle_uint32_t(b->cq[0].n, b->cq[0].a, &b->x);
+		for (i = 0; i < b->cq[0].n; ++i) b->cf[b->cq[0].a[i]] = 0;
+		for (i = n_flip = b->cq[1].n = 0; i < b->cq[0].n; ++i) {
+			k = b->cq[0].a[i];///uid
+			if (!mc_gain_pos(b, k)) continue;
+			// fprintf(stderr, "utg%.6dl, s[k]::%d, s::%d\n", (int32_t)(k)+1, b->s[k], s);
+			mc_set_spin(ma, b, k, b->z[k].z[0] > b->z[k].z[1]? -1 : 1);///no need to change the score of k itself
+			++n_flip;
+			o = ma->idx.a[k] >> 32; n = (uint32_t)ma->idx.a[k];
+			for (j = 0; j < n; ++j) {
+				t = ma_y(ma->ma.a[o + j]);
+				if (b->cf[t] || !mc_gain_pos(b, t)) continue;
+				kv_push(uint32_t, b->cq[1], t); b->cf[t] = 1;
 			}
 		}
 		++n_iter_local;
+		c = b->cq[0]; b->cq[0] = b->cq[1]; b->cq[1] = c;
 		if (n_flip == 0) break;
 	}
+	for (i = 0; i < b->cq[0].n; ++i) b->cf[b->cq[0].a[i]] = 0;
 
 	// if(n_flip != 0) mc_best_flip(ma, b);
 	return mc_score(ma, b);
@@ -2164,9 +2229,106 @@ void print_mc_node(const mc_match_t *ma, mc_svaux_t *b, uint32_t id)
 	for (i = 0; i < hn; i++) fprintf(stderr, "w[%u]-%f, z[%u]-%f\n", i, w[i], i, z[i]);
 }
 
-uint32_t mc_solve_cc(const mc_opt_t *opt, const mc_g_t *mg, mc_svaux_t *b, uint32_t cc_off, uint32_t cc_size)
+#define MC_MS_CC 2048 ///components with >= MC_MS_CC nodes run restarts in batches
+#define MC_MS_BATCH 16 ///restarts per batch; fixed so the result does not depend on # of threads
+
+typedef struct { // data structure for each step in kt_for()
+	const mc_opt_t *opt;
+	const mc_match_t *ma;
+	const mc_svaux_t *b;///current best
+	mc_svaux_t **t;///per-thread spins; s_opt/z_opt keep the best restart of each thread
+	t_w_t *t_sc;
+	uint32_t *t_k, *t_iter, n_thread, k0;
+	uint64_t seed;
+} mc_ms_t;
+
+mc_ms_t *mc_ms_init(const mc_opt_t *opt, const mc_match_t *ma, const mc_svaux_t *b, uint32_t n_thread)
+{
+	uint32_t i; mc_ms_t *ms; CALLOC(ms, 1);
+	if(n_thread > MC_MS_BATCH) n_thread = MC_MS_BATCH;
+	if(n_thread < 1) n_thread = 1;
+	ms->opt = opt; ms->ma = ma; ms->b = b; ms->n_thread = n_thread; ms->seed = b->x;
+	CALLOC(ms->t, n_thread); CALLOC(ms->t_sc, n_thread); 
+	CALLOC(ms->t_k, n_thread); CALLOC(ms->t_iter, n_thread);
+	for (i = 0; i < n_thread; i++) {
+		CALLOC(ms->t[i], 1);
+		kv_init(ms->t[i]->cc_edge);
+		ms->t[i]->cc_off = b->cc_off; ms->t[i]->cc_size = b->cc_size;
+		MALLOC(ms->t[i]->cc_node, b->cc_size);
+		MALLOC(ms->t[i]->bfs, b->cc_size);
+		MALLOC(ms->t[i]->bfs_mark, ma->n_seq);
+		MALLOC(ms->t[i]->s, ma->n_seq); MALLOC(ms->t[i]->s_opt, ma->n_seq);
+		MALLOC(ms->t[i]->z, ma->n_seq); MALLOC(ms->t[i]->z_opt, ma->n_seq);
+		kv_init(ms->t[i]->cq[0]); kv_init(ms->t[i]->cq[1]);
+		CALLOC(ms->t[i]->cf, ma->n_seq);
+	}
+	return ms;
+}
+
+void mc_ms_destroy(mc_ms_t *ms)
 {
-	uint32_t j, k, n_iter = 0, flush = opt->max_iter * 50;
+	uint32_t i;
+	for (i = 0; i < ms->n_thread; i++) {
+		kv_destroy(ms->t[i]->cc_edge); free(ms->t[i]->cc_node);
+		free(ms->t[i]->bfs); free(ms->t[i]->bfs_mark);
+		free(ms->t[i]->s); free(ms->t[i]->s_opt);
+		free(ms->t[i]->z); free(ms->t[i]->z_opt);
+		kv_destroy(ms->t[i]->cq[0]); kv_destroy(ms->t[i]->cq[1]); free(ms->t[i]->cf);
+		free(ms->t[i]);
+	}
+	free(ms->t); free(ms->t_sc); free(ms->t_k); free(ms->t_iter); free(ms);
+}
+
+static void worker_for_mc_ms(void *data, long i, int tid) // callback for kt_for()
+{
+	mc_ms_t *ms = (mc_ms_t*)data;
+	const mc_svaux_t *b = ms->b; mc_svaux_t *t = ms->t[tid];
+	uint32_t j, k = ms->k0 + i, n_iter = 0; t_w_t sc;
+	///every restart starts from the current best, with its own seed
+	for (j = 0; j < b->cc_size; ++j) {
+		t->cc_node[j] = b->cc_node[j];
+		t->s[b->cc_node[j]] = b->s[b->cc_node[j]];
+		t->z[b->cc_node[j]] = b->z[b->cc_node[j]];
+		t->bfs_mark[b->cc_node[j]] = (uint32_t)-1;
+	}
+	t->x = kr_splitmix64(ms->seed ^ k);
+	if (k&1) mc_perturb(ms->opt, ms->ma, t);
+	else mc_perturb_node(ms->opt, ms->ma, t, 3);
+	sc = mc_optimize_local(ms->opt, ms->ma, t, &n_iter);
+	ms->t_iter[tid] += n_iter;
+	if(ms->t_k[tid] == (uint32_t)-1 || sc > ms->t_sc[tid] || (sc == ms->t_sc[tid] && k < ms->t_k[tid])) {
+		ms->t_sc[tid] = sc; ms->t_k[tid] = k;
+		for (j = 0; j < b->cc_size; ++j) {
+			t->s_opt[b->cc_node[j]] = t->s[b->cc_node[j]];
+			t->z_opt[b->cc_node[j]] = t->z[b->cc_node[j]];
+		}
+	}
+}
+
+///restarts [k0, k0+n) from the current best in parallel; the best one is kept if it beats sc_opt
+static uint32_t mc_perturb_ms(mc_ms_t *ms, mc_svaux_t *b, uint32_t k0, uint32_t n, t_w_t *sc_opt, uint32_t *n_iter)
+{
+	uint32_t i, j, m = (uint32_t)-1;
+	for (i = 0; i < ms->n_thread; i++) ms->t_k[i] = (uint32_t)-1, ms->t_iter[i] = 0;
+	ms->k0 = k0;
+	kt_for(ms->n_thread, worker_for_mc_ms, ms, n);
+	for (i = 0; i < ms->n_thread; i++) {
+		(*n_iter) += ms->t_iter[i];
+		if(ms->t_k[i] == (uint32_t)-1) continue;
+		if(m == (uint32_t)-1 || ms->t_sc[i] > ms->t_sc[m] || (ms->t_sc[i] == ms->t_sc[m] && ms->t_k[i] < ms->t_k[m])) m = i;
+	}
+	if(m == (uint32_t)-1 || ms->t_sc[m] <= (*sc_opt)) return 0;
+	for (j = 0; j < b->cc_size; ++j) {
+		b->s[b->cc_node[j]] = b->s_opt[b->cc_node[j]] = ms->t[m]->s_opt[b->cc_node[j]];
+		b->z[b->cc_node[j]] = b->z_opt[b->cc_node[j]] = ms->t[m]->z_opt[b->cc_node[j]];
+	}
+	(*sc_opt) = ms->t_sc[m];
+	return 1;
+}
+
+uint32_t mc_solve_cc(const mc_opt_t *opt, const mc_g_t *mg, mc_svaux_t *b, uint32_t cc_off, uint32_t cc_size, uint32_t n_thread)
+{
+	uint32_t j, k, n_iter = 0, flush = opt->max_iter * 50, n0; mc_ms_t *ms = NULL;
 	t_w_t sc_opt = -(1<<30), sc;///problem-w
 	b->cc_off = cc_off, b->cc_size = cc_size;
 	if (b->cc_size < 2) return 0;
@@ -2197,7 +2359,18 @@ uint32_t mc_solve_cc(const mc_opt_t *opt, const mc_g_t *mg, mc_svaux_t *b, uint3
 	// mc_reset_z_debug(mg->e, b);
 	// print_sc(opt, mg->e, b, sc_opt, n_iter);
 	// fprintf(stderr, "\ncc_size: %u, cc_off: %u\n", b->cc_size, b->cc_off);
-	for (k = 0; k < (uint32_t)opt->n_perturb; ++k) {
+	if (b->cc_size >= MC_MS_CC) ms = mc_ms_init(opt, mg->e, b, n_thread);
+	for (k = 0; ms && k < (uint32_t)opt->n_perturb; k += MC_MS_BATCH) {
+		n0 = n_iter;
+		mc_perturb_ms(ms, b, k, MIN(MC_MS_BATCH, (uint32_t)opt->n_perturb - k), &sc_opt, &n_iter);
+		if(n0/flush != n_iter/flush) {
+			mc_reset_z(mg->e, b);
+			sc_opt = mc_score(mg->e, b);
+			for (j = 0; j < b->cc_size; ++j) b->z_opt[b->cc_node[j]] = b->z[b->cc_node[j]];
+		}
+	}
+	if (ms) mc_ms_destroy(ms);
+	for (k = 0; b->cc_size < MC_MS_CC && k < (uint32_t)opt->n_perturb; ++k) {
 		if (k&1) mc_perturb(opt, mg->e, b);
 		else mc_perturb_node(opt, mg->e, b, 3);
 		sc = mc_optimize_local(opt, mg->e, b, &n_iter);
@@ -2731,9 +2904,10 @@ t_w_t mc_clus_cc(mc_clus_t *bc)
 	return sc;
 }
 
-uint32_t mc_solve_cc_adv(const mc_opt_t *opt, const mc_g_t *mg, mc_svaux_t *b, uint32_t cc_off, uint32_t cc_size, mc_clus_t *bc)
+uint32_t mc_solve_cc_adv(const mc_opt_t *opt, const mc_g_t *mg, mc_svaux_t *b, uint32_t cc_off, uint32_t cc_size, mc_clus_t *bc, uint32_t n_thread)
 {
-	uint32_t j, k, n_iter = 0, flush = opt->max_iter * 50, n_skip, n_skip_flush = opt->n_perturb/16;
+	uint32_t j, k, n_iter = 0, flush = opt->max_iter * 50, n_skip, n_skip_flush = opt->n_perturb/16, kn, n0; 
+	mc_ms_t *ms = NULL;
 	t_w_t sc_opt = -(1<<30), sc;///problem-w
 	b->cc_off = cc_off, b->cc_size = cc_size;
 	if (b->cc_size < 2) return 0;
@@ -2783,7 +2957,35 @@ uint32_t mc_solve_cc_adv(const mc_opt_t *opt, const mc_g_t *mg, mc_svaux_t *b, u
 		}
 	}
 	
-	for (k = n_skip = 0; k < (uint32_t)opt->n_perturb; ++k) {
+	if (b->cc_size >= MC_MS_CC) ms = mc_ms_init(opt, mg->e, b, n_thread);
+	for (k = n_skip = 0; ms && k < (uint32_t)opt->n_perturb; k += MC_MS_BATCH) {
+		kn = MIN(MC_MS_BATCH, (uint32_t)opt->n_perturb - k); n0 = n_iter;
+		if(mc_perturb_ms(ms, b, k, kn, &sc_opt, &n_iter)) n_skip = 0;
+		else n_skip += kn;
+		if(n_skip >= n_skip_flush && bc) {
+			sc = mc_clus_cc(bc);
+			if (sc > sc_opt) {
+				for (j = 0; j < b->cc_size; ++j) {
+					b->s_opt[b->cc_node[j]] = b->s[b->cc_node[j]];
+					b->z_opt[b->cc_node[j]] = b->z[b->cc_node[j]];
+				}
+				sc_opt = sc;
+			} else {
+				for (j = 0; j < b->cc_size; ++j) {
+					b->s[b->cc_node[j]] = b->s_opt[b->cc_node[j]];
+					b->z[b->cc_node[j]] = b->z_opt[b->cc_node[j]];
+				}
+			}
+			n_skip = 0;
+		}
+		if(n0/flush != n_iter/flush) {
+			mc_reset_z(mg->e, b);
+			sc_opt = mc_score(mg->e, b);
+			for (j = 0; j < b->cc_size; ++j) b->z_opt[b->cc_node[j]] = b->z[b->cc_node[j]];
+		}
+	}
+	if (ms) mc_ms_destroy(ms);
+	for (k = n_skip = 0; b->cc_size < MC_MS_CC && k < (uint32_t)opt->n_perturb; ++k) {
 		if (k&1) mc_perturb(opt, mg->e, b);
 		else mc_perturb_node(opt, mg->e, b, 3);
 		sc = mc_optimize_local(opt, mg->e, b, &n_iter);
@@ -3301,12 +3503,33 @@ void mb_solve_core(mc_opt_t *opt, mc_g_t *mg, kv_u_trans_t *ref, uint32_t is_sys
 }
 
 
+typedef struct { // data structure for each step in kt_for()
+	const mc_opt_t *opt;
+	const mc_g_t *mg;
+	mc_svaux_t **b;
+	mc_clus_t **bc;
+	uint64_t *cc;
+	uint32_t n_thread;///threads of each component
+	uint8_t is_adv;
+} mc_cc_aux_t;
+
+static void worker_for_mc_cc(void *data, long i, int tid) // callback for kt_for()
+{
+	mc_cc_aux_t *aux = (mc_cc_aux_t*)data;
+	mc_svaux_t *b = aux->b[tid];
+	uint32_t cc_off = (uint32_t)aux->cc[i], cc_size = (uint32_t)-1 - (uint32_t)(aux->cc[i]>>32);
+	b->x = mc_cc_seed(aux->opt, aux->mg->e, cc_off);
+	if(aux->is_adv) mc_solve_cc_adv(aux->opt, aux->mg, b, cc_off, cc_size, aux->bc[tid], aux->n_thread);
+	else mc_solve_cc(aux->opt, aux->mg, b, cc_off, cc_size, aux->n_thread);
+}
+
 void mc_solve_core(const mc_opt_t *opt, mc_g_t *mg, bubble_type* bub)
 {
 	double index_time = yak_realtime();
-	uint32_t st, i;
+	uint32_t i, cc_n, max_cc, n_thread, n_big; uint64_t *cc;
 	mc_svaux_t *b;
 	mc_bp_t *bp = NULL;
+	mc_cc_aux_t aux;
 	mc_g_cc(mg->e);
 	b = mc_svaux_init(mg, opt->seed);
 	if(bub) bp = mc_bp_t_init(mg->e, b, bub, asm_opt.thread_num);
@@ -3319,12 +3542,26 @@ void mc_solve_core(const mc_opt_t *opt, mc_g_t *mg, bubble_type* bub)
 		fprintf(stderr, "\n\n\n\n\n*************beg-[M::%s::score->%f] ==> Partition\n", __func__, mc_score_all_advance(mg->e, mg->s.a));
 	}
 	
-	for (st = 0, i = 1; i <= mg->e->n_seq; ++i) {
-		if (i == mg->e->n_seq || mg->e->cc[st]>>32 != mg->e->cc[i]>>32) {
-			mc_solve_cc(opt, mg, b, st, i - st);
-			st = i;
-		}
-	}
+	///components are independent; solve them largest first
+	memset(&aux, 0, sizeof(aux));
+	aux.opt = opt; aux.mg = mg; aux.is_adv = 0;
+	aux.cc = cc = mc_g_cc_srt(mg->e, &cc_n, &max_cc);
+	n_thread = asm_opt.thread_num; if(n_thread < 1) n_thread = 1;
+	///large components run their restarts with all threads, one at a time
+	for (n_big = 0; n_big < cc_n && n_thread > 1; n_big++) {
+		if((uint32_t)-1 - (uint32_t)(cc[n_big]>>32) < MC_MS_CC) break;
+	}
+	aux.b = &b; aux.n_thread = n_thread;
+	for (i = 0; i < n_big; i++) worker_for_mc_cc(&aux, i, 0);
+
+	if(n_thread > cc_n - n_big) n_thread = cc_n - n_big;
+	if(n_thread < 1) n_thread = 1;
+	MALLOC(aux.b, n_thread); aux.b[0] = b;
+	for (i = 1; i < n_thread; i++) aux.b[i] = mc_svaux_dup(b, max_cc);
+	aux.cc = cc + n_big; aux.n_thread = 1;
+	kt_for(n_thread, worker_for_mc_cc, &aux, cc_n - n_big);
+	for (i = 1; i < n_thread; i++) mc_svaux_dup_destroy(aux.b[i]);
+	free(aux.b); free(cc);
 
 	if(VERBOSE_CUT)
 	{
@@ -3453,8 +3690,8 @@ asg64_v* gen_ref_bub(mc_clus_t *bc, kv_u_trans_t *ref)
 void mc_solve_core_adv(const mc_opt_t *opt, mc_g_t *mg, bubble_type* bub, kv_u_trans_t *ref)
 {
 	double index_time = yak_realtime();
-	uint32_t st, i;
-	mc_svaux_t *b; mc_clus_t *bc; 
+	uint32_t i, cc_n, max_cc, n_thread, n_big; uint64_t tot, sz, *cc;
+	mc_svaux_t *b; mc_clus_t *bc; mc_cc_aux_t aux;
 	// mc_bp_t *bp = NULL;
 	mc_g_cc(mg->e);
 	b = mc_svaux_init(mg, opt->seed);
@@ -3471,12 +3708,36 @@ void mc_solve_core_adv(const mc_opt_t *opt, mc_g_t *mg, bubble_type* bub, kv_u_t
 		fprintf(stderr, "\n\n\n\n\n*************beg-[M::%s::score->%f] ==> Partition\n", __func__, mc_score_all_advance(mg->e, mg->s.a));
 	}
 	
-	for (st = 0, i = 1; i <= mg->e->n_seq; ++i) {
-		if (i == mg->e->n_seq || mg->e->cc[st]>>32 != mg->e->cc[i]>>32) {
-			mc_solve_cc_adv(opt, mg, b, st, i - st, bc);
-			st = i;
-		}
-	}
+	///components are independent; solve them largest first
+	memset(&aux, 0, sizeof(aux));
+	aux.opt = opt; aux.mg = mg; aux.is_adv = 1;
+	aux.cc = cc = mc_g_cc_srt(mg->e, &cc_n, &max_cc);
+	n_thread = asm_opt.thread_num; if(n_thread < 1) n_thread = 1;
+	///a large component, or one taking at least 1/n_thread of all nodes, is solved alone with all threads
+	for (i = 0, tot = 0; i < cc_n; i++) tot += (uint32_t)-1 - (uint32_t)(cc[i]>>32);
+	for (n_big = 0; n_big < cc_n && n_thread > 1; n_big++) {
+		sz = (uint32_t)-1 - (uint32_t)(cc[n_big]>>32);
+		if(sz < MC_MS_CC && sz*n_thread < tot) break;
+	}
+	aux.b = &b; aux.bc = &bc; aux.n_thread = n_thread;
+	for (i = 0; i < n_big; i++) worker_for_mc_cc(&aux, i, 0);
+
+	if(n_thread > cc_n - n_big) n_thread = cc_n - n_big;
+	if(n_thread < 1) n_thread = 1;
+	MALLOC(aux.b, n_thread); MALLOC(aux.bc, n_thread);
+	for (i = 0; i < n_thread; i++) {
+		aux.b[i] = i? mc_svaux_dup(b, max_cc) : b;
+		aux.bc[i] = init_mc_clus_t(opt, mg, bub, 1, aux.b[i], 16);
+		if(aux.bc[i] && bc) aux.bc[i]->asn = bc->asn;
+	}
+	aux.cc = cc + n_big; aux.n_thread = 1;
+	kt_for(n_thread, worker_for_mc_cc, &aux, cc_n - n_big);
+	for (i = 0; i < n_thread; i++) {
+		if(aux.bc[i]) aux.bc[i]->asn = NULL;
+		des_mc_clus_t(aux.bc[i]);
+		if(i) mc_svaux_dup_destroy(aux.b[i]);
+	}
+	free(aux.b); free(aux.bc); free(cc);
 
 	if(VERBOSE_CUT)
 	{
@@ -3906,6 +4167,8 @@ typedef struct {
 	mcb_t *m;
 	mcg_node_t mask;
 	uint32_t hapN;
+	asg32_v cq[2];///candidates of mcgg_optimize_local()
+	uint8_t *cf;///if a node is in cq
 } mcgg_svaux_t;
 
 mc_poy_t *init_mc_poy_t(uint32_t un, uint32_t hapN)
@@ -3949,6 +4212,8 @@ mcgg_svaux_t *mcgg_svaux_init(const mc_gg_t *mg, uint64_t x, uint32_t hapN)
 	b->m = mg->m.a;
 	b->mask = ((mcg_node_t)1)<<hapN; b->mask--;
 	b->hapN = hapN;
+	kv_init(b->cq[0]); kv_init(b->cq[1]);
+	CALLOC(b->cf, ma->n_seq);
     return b;
 }
 
@@ -3960,9 +4225,29 @@ void mcgg_svaux_destroy(mcgg_svaux_t *b)
     destroy_mc_poy_t(&(b->z)); 
 	destroy_mc_poy_t(&(b->z_opt));
     free(b->bfs); free(b->bfs_mark);
+	kv_destroy(b->cq[0]); kv_destroy(b->cq[1]); free(b->cf);
     free(b);
 }
 
+///per-thread copy of b; arrays indexed by node are shared since components are disjoint
+mcgg_svaux_t *mcgg_svaux_dup(const mcgg_svaux_t *b, uint32_t max_cc)
+{
+	mcgg_svaux_t *p; CALLOC(p, 1);
+	*p = *b;
+	kv_init(p->cc_edge);
+	MALLOC(p->cc_node, max_cc);
+	MALLOC(p->bfs, max_cc);
+	kv_init(p->cq[0]); kv_init(p->cq[1]);
+	return p;
+}
+
+void mcgg_svaux_dup_destroy(mcgg_svaux_t *p)
+{
+	kv_destroy(p->cc_edge); free(p->cc_node); free(p->bfs);
+	kv_destroy(p->cq[0]); kv_destroy(p->cq[1]);
+	free(p);
+}
+
 static inline mcg_node_t kr_drand_node(uint64_t id, mcgg_svaux_t *b, uint16_t *hc)
 {
 	uint16_t hn = b->s[id].h[0]-1;
@@ -4180,25 +4465,40 @@ static void mcgg_set_spin(const mc_match_t *ma, mcgg_svaux_t *b, uint32_t k, mcg
 
 static t_w_t mcgg_optimize_local(const mc_opt_t *opt, const mc_match_t *ma, mcgg_svaux_t *b, uint32_t *n_iter)
 {
-	uint32_t i, n_flip = 0;
+	uint32_t i, j, k, t, o, n, n_flip = 0;
 	int32_t n_iter_local = 0;
 	mcg_node_t ms;
+	asg32_v c;
+	///get_max_m() only changes when z changes, so a node is only revisited after one of its neighbours flips
+	for (i = b->cq[0].n = 0; i < b->cc_size; ++i) {
+		k = (uint32_t)ma->cc[b->cc_off + i];///uid
+		kv_push(uint32_t, b->cq[0], k); b->cf[k] = 1;
+	}
 	while (n_iter_local < opt->max_iter) {
 		++(*n_iter);
-		ks_shuffle_uint32_t(b->cc_size, b->cc_node, &b->x);
-		for (i = n_flip = 0; i < b->cc_size; ++i) {
-			uint32_t k = b->cc_node[i];///uid
+		ks_shuffle_uint32_t(b->cq[0].n, b->cq[0].a, &b->x);
+		for (i = 0; i < b->cq[0].n; ++i) b->cf[b->cq[0].a[i]] = 0;
+		for (i = n_flip = b->cq[1].n = 0; i < b->cq[0].n; ++i) {
+			k = b->cq[0].a[i];///uid
 			ms = get_max_m(k, b);
 			if(ms != b->s[k].s)
 			{
 				mcgg_set_spin(ma, b, k, ms, __func__);///no need to change the score of k itself
 				// debug_hapM(&(b->s[k]), "s4");
 				++n_flip;
+				o = ma->idx.a[k] >> 32; n = (uint32_t)ma->idx.a[k];
+				for (j = 0; j < n; ++j) {
+					t = ma_y(ma->ma.a[o + j]);
+					if (b->cf[t]) continue;
+					kv_push(uint32_t, b->cq[1], t); b->cf[t] = 1;
+				}
 			}
 		}
 		++n_iter_local;
+		c = b->cq[0]; b->cq[0] = b->cq[1]; b->cq[1] = c;
 		if (n_flip == 0) break;
 	}
+	for (i = 0; i < b->cq[0].n; ++i) b->cf[b->cq[0].a[i]] = 0;
 
 	return mcgg_score(ma, b);
 }
@@ -4373,11 +4673,27 @@ uint32_t mcgg_solve_cc(const mc_opt_t *opt, const mc_gg_t *mg, mcgg_svaux_t *b,
 	return n_iter;
 }
 
+typedef struct { // data structure for each step in kt_for()
+	const mc_opt_t *opt;
+	const mc_gg_t *mg;
+	mcgg_svaux_t **b;
+	uint64_t *cc;
+} mcgg_cc_aux_t;
+
+static void worker_for_mcgg_cc(void *data, long i, int tid) // callback for kt_for()
+{
+	mcgg_cc_aux_t *aux = (mcgg_cc_aux_t*)data;
+	mcgg_svaux_t *b = aux->b[tid];
+	uint32_t cc_off = (uint32_t)aux->cc[i], cc_size = (uint32_t)-1 - (uint32_t)(aux->cc[i]>>32);
+	b->x = mc_cc_seed(aux->opt, aux->mg->e, cc_off);
+	mcgg_solve_cc(aux->opt, aux->mg, b, cc_off, cc_size);
+}
+
 void mc_solve_core_genral(const mc_opt_t *opt, mc_gg_t *mg, uint32_t hapN)
 {
 	double index_time = yak_realtime();
-	uint32_t st, i;
-	mcgg_svaux_t *b;
+	uint32_t i, cc_n, max_cc, n_thread;
+	mcgg_svaux_t *b; mcgg_cc_aux_t aux;
 	mc_g_cc(mg->e);
 	b = mcgg_svaux_init(mg, opt->seed, hapN);
 	// if(VERBOSE_CUT)
@@ -4385,12 +4701,17 @@ void mc_solve_core_genral(const mc_opt_t *opt, mc_gg_t *mg, uint32_t hapN)
 	// 	fprintf(stderr, "\n\n\n\n\n*************beg-[M::%s::score->%f] ==> Partition\n", __func__, mc_score_all_advance(mg->e, mg->s.a));
 	// }
 	
-	for (st = 0, i = 1; i <= mg->e->n_seq; ++i) {
-		if (i == mg->e->n_seq || mg->e->cc[st]>>32 != mg->e->cc[i]>>32) {
-			mcgg_solve_cc(opt, mg, b, st, i - st);
-			st = i;
-		}
-	}
+	///components are independent; solve them largest first
+	aux.opt = opt; aux.mg = mg;
+	aux.cc = mc_g_cc_srt(mg->e, &cc_n, &max_cc);
+	n_thread = asm_opt.thread_num; 
+	if(n_thread > cc_n) n_thread = cc_n;
+	if(n_thread < 1) n_thread = 1;
+	MALLOC(aux.b, n_thread); aux.b[0] = b;
+	for (i = 1; i < n_thread; i++) aux.b[i] = mcgg_svaux_dup(b, max_cc);
+	kt_for(n_thread, worker_for_mcgg_cc, &aux, cc_n);
+	for (i = 1; i < n_thread; i++) mcgg_svaux_dup_destroy(aux.b[i]);
+	free(aux.b); free(aux.cc);
 
 	// if(VERBOSE_CUT)
 	// {